@@ -0,0 +1,86 @@
+/**
+ * Raw pulse capture over a CDC interface. See librabi/capture.h
+ * for the format.
+ **/
+#include "tusb.h"
+#include "akela_capture.h"
+
+bool capture_enabled;
+static uint32_t tick_hz;
+
+/* Filled and drained by the main loop only */
+static uint16_t ring[CAPTURE_RING];
+static uint32_t head, tail;
+static uint32_t dropped;
+
+static inline uint32_t ring_free(void)
+{
+    return CAPTURE_RING - (head - tail);
+}
+
+static inline void put(uint16_t w)
+{
+    ring[head++ % CAPTURE_RING] = w;
+}
+
+//Only whole messages go in, so the host never loses track of the markers
+static bool reserve(uint32_t words)
+{
+    //keep room to report what we drop
+    if (ring_free() < words + 2) {
+        dropped++;
+        return false;
+    }
+    if (dropped) {
+        put(CAP_DROPPED);
+        put(dropped > 0xFFFF ? 0xFFFF : dropped);
+        dropped = 0;
+    }
+    return true;
+}
+
+void capture_pulse(uint32_t ticks)
+{
+    if (!capture_enabled || !reserve(1)) return;
+    put(ticks < CAP_SATURATED ? ticks : CAP_SATURATED);
+}
+
+void capture_marker(uint16_t marker, uint32_t value)
+{
+    if (!capture_enabled || !reserve(3)) return;
+    put(marker);
+    put(value & 0xFFFF);
+    put(value >> 16);
+}
+
+void capture_init(uint32_t hz)
+{
+    tick_hz = hz;
+}
+
+void capture_task(void)
+{
+    bool connected = tud_cdc_n_connected(CAPTURE_ITF);
+
+    if (connected != capture_enabled) {
+        head = tail = dropped = 0;
+        capture_enabled = connected;
+        //Everything we need to turn ticks into time
+        capture_marker(CAP_TICK_HZ, tick_hz);
+    }
+    if (!capture_enabled) return;
+
+    uint32_t n = head - tail;
+    if (!n) return;
+
+    //Up to the end of the ring, the rest goes next time
+    uint32_t start = tail % CAPTURE_RING;
+    if (start + n > CAPTURE_RING) n = CAPTURE_RING - start;
+    uint32_t avail = tud_cdc_n_write_available(CAPTURE_ITF) / 2;
+    if (n > avail) n = avail;
+    if (!n) return;
+
+    //The RP2040 is little endian, just like the stream
+    tail += tud_cdc_n_write(CAPTURE_ITF, &ring[start], n * 2) / 2;
+    tud_cdc_n_write_flush(CAPTURE_ITF);
+}
@@ -0,0 +1,24 @@
+#ifndef AKELA_CAPTURE_H
+#define AKELA_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "capture.h"
+
+/* CDC interface the capture goes out on. Capturing starts when the host
+ * opens it and stops when it is closed. */
+#define CAPTURE_ITF 1
+
+/* Words buffered towards USB, 8KB is ~160ms of pulses at full rate */
+#define CAPTURE_RING 4096
+
+extern bool capture_enabled;
+
+void capture_init(uint32_t tick_hz);
+void capture_pulse(uint32_t ticks);
+void capture_marker(uint16_t marker, uint32_t value);
+
+/* Move what we have to USB. Call from the main loop */
+void capture_task(void);
+
+#endif
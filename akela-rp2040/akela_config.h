@@ -0,0 +1,32 @@
+#ifndef AKELA_CONFIG_H
+#define AKELA_CONFIG_H
+
+#include "rabi.pio.h"
+
+#define K 1             /* Number if inputs per RABI */
+#define W 25            /* Number of RABIs */
+#define DELTA 0         /* Delta polls, must match raddr/wolf.h */
+#define HALL 0          /* Hall-effect keys, must match make USE_HALL of the rabies */
+/* A cry every SCAN_US, e.g. 1000 for 1kHz. 0 for as fast as the pack goes.
+ * The period stretches to what a cry takes, a full cry of W=25 is ~3.8ms */
+#define SCAN_US 0
+/* Key events as soon as the frame of their rabi is in, not after the howl.
+ * The first rabies of a long pack get to the host up to a cry sooner. Not
+ * after a bad frame or a bit slip, those wait for the end of the cry */
+#define STREAM 0
+
+/* Positions of rabies built with make USE_ENCODER=y and what they do, see
+ * akela_encoder.h. Needs K > 1 */
+//#define ENCODERS {{24, ENC_SCROLL}}
+#define ENCODER_DETENT 4    /* counts per click */
+
+#define T_BIT_US    TTOTAL
+#define T_RESET_US  (3 * TRESET)
+#define T0H_US      T0H
+#define T1H_US      T1H
+#define T_RESET_H_US (2 * TRESET)
+
+#define AKELA_LOG 1     /* Status lines on the serial console */
+//#define LATENCY_PIN 5   /* High from a cry with a key change until the host has it */
+
+#endif
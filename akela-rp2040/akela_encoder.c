@@ -0,0 +1,100 @@
+/**
+ * Rotary encoders in the pack, the counts to HID reports
+ **/
+#include "tusb.h"
+#include "usb_descriptors.h"
+#include "akela_encoder.h"
+#include "akela.h"
+
+#ifndef ENCODER_DETENT
+#define ENCODER_DETENT 4
+#endif
+
+#define COUNT_MASK ((1u << K) - 1)
+
+#ifndef ENCODERS
+#define ENCODERS {}
+#elif K < 2
+#error "An encoder needs K > 1"
+#endif
+
+static const struct {
+    uint8_t at;                 //position in the pack
+    uint8_t usage;              //enum encoder_usage
+} encoders[] = ENCODERS;
+#define N_ENCODERS (sizeof(encoders) / sizeof(encoders[0]))
+
+static struct {
+    bool seen;
+    uint8_t count;
+    int16_t counts;             //not a click yet
+} state[N_ENCODERS];
+
+static int clicks[2];           //by usage, not sent yet
+static bool volume_down;        //a volume usage was sent, release it
+
+bool encoder_at(int i)
+{
+    for (unsigned e = 0; e < N_ENCODERS; e++)
+        if (encoders[e].at == i)
+            return true;
+    return false;
+}
+
+void encoder_cry(int n_rabies)
+{
+    for (unsigned e = 0; e < N_ENCODERS; e++) {
+        int i = encoders[e].at;
+        //Gone, its count may start over when it is back
+        if (i >= n_rabies || i >= W) {
+            state[e].seen = false;
+            continue;
+        }
+        uint8_t count = key_states_read[i] & COUNT_MASK;
+        if (!state[e].seen) {
+            state[e].seen = true;
+            state[e].count = count;
+            continue;
+        }
+        //The shortest way around
+        int d = (count - state[e].count) & COUNT_MASK;
+        if (d > (int)(COUNT_MASK / 2))
+            d -= COUNT_MASK + 1;
+        state[e].count = count;
+        state[e].counts += d;
+        int c = state[e].counts / ENCODER_DETENT;
+        state[e].counts -= c * ENCODER_DETENT;
+        clicks[encoders[e].usage] += c;
+    }
+}
+
+static int take(int *c, int max)
+{
+    int n = *c < -max ? -max : *c > max ? max : *c;
+    *c -= n;
+    return n;
+}
+
+bool encoder_report(void)
+{
+    if (!tud_hid_ready())
+        return false;
+
+    if (volume_down) {
+        uint16_t none = 0;
+        volume_down = false;
+        return tud_hid_report(REPORT_ID_CONSUMER_CONTROL, &none, sizeof(none));
+    }
+    int wheel = take(&clicks[ENC_SCROLL], 127);
+    if (wheel)
+        return tud_hid_mouse_report(REPORT_ID_MOUSE, 0, 0, 0, wheel, 0);
+    //A click a press, the host repeats nothing
+    int volume = take(&clicks[ENC_VOLUME], 1);
+    if (volume) {
+        uint16_t usage = volume > 0 ? HID_USAGE_CONSUMER_VOLUME_INCREMENT
+                                    : HID_USAGE_CONSUMER_VOLUME_DECREMENT;
+        volume_down = true;
+        return tud_hid_report(REPORT_ID_CONSUMER_CONTROL, &usage, sizeof(usage));
+    }
+    return false;
+}
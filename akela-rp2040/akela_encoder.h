@@ -0,0 +1,29 @@
+#ifndef AKELA_ENCODER_H
+#define AKELA_ENCODER_H
+/**
+ * Rotary encoders in the pack, rabies built with make USE_ENCODER=y
+ *
+ * Their frame is the count of the encoder modulo 2^K. After every cry the
+ * difference with the count before is added up, so a frame lost to a glitch
+ * loses no steps. Unless the encoder turned 2^(K-1) counts in the meantime.
+ * Every ENCODER_DETENT counts is a click, sent as the wheel of the mouse or
+ * as volume up and down. Which rabies are encoders is ENCODERS in
+ * akela_config.h, none if it is not defined.
+ **/
+#include <stdint.h>
+#include <stdbool.h>
+
+enum encoder_usage {
+    ENC_SCROLL,
+    ENC_VOLUME,
+};
+
+/* Rabi i is an encoder, its frame is not a key */
+bool encoder_at(int i);
+/* After every cry, with the number of rabies in it */
+void encoder_cry(int n_rabies);
+/* Sends the next report for the clicks so far, if the HID is ready.
+ * Returns true if it sent one */
+bool encoder_report(void);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * Latency from the Akela to the host, see akela_latency.h
+ **/
+#include "pico/stdlib.h"
+#include "akela.h"
+#include "akela_telemetry.h"
+#include "akela_latency.h"
+
+static uint64_t t_change;       //end of the first cry with a change not sent
+static uint64_t t_in_flight;    //of the report on its way to the host
+
+static void pin(bool on)
+{
+#ifdef LATENCY_PIN
+    gpio_put(LATENCY_PIN, on);
+#endif
+}
+
+void latency_init(void)
+{
+#ifdef LATENCY_PIN
+    gpio_init(LATENCY_PIN);
+    gpio_set_dir(LATENCY_PIN, GPIO_OUT);
+#endif
+}
+
+void latency_cry(uint64_t t_now_us)
+{
+    if (!t_unreported_edge || t_change)
+        return;
+    t_change = t_now_us;
+    pin(1);
+}
+
+void latency_cancel(void)
+{
+    t_change = 0;
+    if (!t_in_flight)
+        pin(0);
+}
+
+void latency_report(void)
+{
+    //One report is in flight at a time, tud_hid_ready() sees to that
+    t_in_flight = t_change;
+    t_change = 0;
+}
+
+void latency_done(uint64_t t_now_us)
+{
+    if (!t_in_flight)
+        return;
+    telemetry_latency(t_now_us - t_in_flight);
+    t_in_flight = 0;
+    if (!t_change)
+        pin(0);
+}
@@ -0,0 +1,27 @@
+#ifndef AKELA_LATENCY_H
+#define AKELA_LATENCY_H
+/**
+ * Latency from the Akela to the host
+ *
+ * From the end of the first cry that brought a key change, until the host
+ * took the keyboard report with it: the complete callback of the HID. Goes
+ * into the TM_REC_LATENCY_HIST of the telemetry, see librabi/telemetry.h.
+ * The age of the edge at the rabi comes on top of it, at most a cry.
+ *
+ * With LATENCY_PIN in akela_config.h that pin goes high at the end of the
+ * cry and low when the host has the report, for a scope.
+ **/
+#include <stdint.h>
+#include <stdbool.h>
+
+void latency_init(void);
+/* After every cry */
+void latency_cry(uint64_t t_now_us);
+/* The change needs no keyboard report after all */
+void latency_cancel(void);
+/* The keyboard report went out */
+void latency_report(void);
+/* The host took it */
+void latency_done(uint64_t t_now_us);
+
+#endif
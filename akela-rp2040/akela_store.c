@@ -0,0 +1,295 @@
+/**
+ * Settings in flash, see akela_store.h
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "akela.h"
+#include "akela_store.h"
+
+/* The two sectors below the map of akela_topology.c, the last one */
+#define STORE_FLASH_OFFSET  (PICO_FLASH_SIZE_BYTES - 3 * FLASH_SECTOR_SIZE)
+#define SLOTS       (FLASH_SECTOR_SIZE / sizeof(struct record))
+#define PAGE_SLOTS  (FLASH_PAGE_SIZE / sizeof(struct record))
+#define HEADER      0       //first record of a sector, the value is its generation
+#define BLANK       0xFFFF  //key of an erased record
+
+struct record {
+    uint16_t key;
+    uint16_t check;
+    uint32_t value;
+};
+
+static struct setting {
+    uint16_t key;
+    bool dirty;             //not in flash yet
+    uint32_t value;
+} settings[STORE_MAX];
+static unsigned n_settings;
+
+static unsigned active;         //sector of the log
+static uint32_t generation;     //of the log, 0 if it has no header yet
+static unsigned next_slot;      //in the log, SLOTS when it is full
+static bool other_erased;
+static bool compacting;         //copying the settings to the other sector
+static unsigned copied;         //so far
+static uint64_t t_cry, t_change;
+static uint32_t events_seen;
+
+static uint16_t check(uint16_t key, uint32_t value)
+{
+    return key ^ value ^ value >> 16 ^ 0x5AA5;
+}
+
+static const struct record *sector(unsigned s)
+{
+    return (const struct record *)(XIP_BASE + STORE_FLASH_OFFSET + s * FLASH_SECTOR_SIZE);
+}
+
+static bool erased(const struct record *r)
+{
+    return r->key == BLANK && r->check == 0xFFFF && r->value == 0xFFFFFFFF;
+}
+
+static bool valid(const struct record *r)
+{
+    return r->check == check(r->key, r->value);
+}
+
+static bool has_header(unsigned s)
+{
+    return sector(s)[0].key == HEADER && valid(&sector(s)[0]);
+}
+
+static bool blank(unsigned s)
+{
+    for (unsigned i = 0; i < SLOTS; i++)
+        if (!erased(&sector(s)[i])) return false;
+    return true;
+}
+
+static struct setting *find(uint16_t key)
+{
+    for (unsigned i = 0; i < n_settings; i++)
+        if (settings[i].key == key) return &settings[i];
+    return NULL;
+}
+
+void store_init(void)
+{
+    bool a = has_header(0), b = has_header(1);
+
+    n_settings = 0;
+    compacting = false;
+    active = b && (!a || sector(1)[0].value > sector(0)[0].value);
+    other_erased = blank(!active);
+    generation = 0;
+    next_slot = 0;
+    if (!a && !b) {
+        //Never used, or by something else: full until it is erased
+        if (!blank(active))
+            next_slot = SLOTS;
+        return;
+    }
+
+    const struct record *r = sector(active);
+    generation = r[0].value;
+    for (unsigned i = 1; i < SLOTS; i++) {
+        if (erased(&r[i])) continue;
+        next_slot = i + 1;
+        //Torn by a power cut, or for a key that is not ours
+        if (!valid(&r[i]) || r[i].key == HEADER || r[i].key == BLANK) continue;
+        struct setting *s = find(r[i].key);
+        if (!s && n_settings < STORE_MAX) {
+            s = &settings[n_settings++];
+            s->key = r[i].key;
+        }
+        if (s)
+            s->value = r[i].value;
+    }
+    if (!next_slot)
+        next_slot = 1;
+}
+
+uint32_t store_get(uint16_t key, uint32_t dflt)
+{
+    struct setting *s = find(key);
+    return s ? s->value : dflt;
+}
+
+bool store_set(uint16_t key, uint32_t value)
+{
+    struct setting *s = find(key);
+
+    if (key == HEADER || key == BLANK)
+        return false;
+    if (!s) {
+        if (n_settings == STORE_MAX)
+            return false;
+        s = &settings[n_settings++];
+        s->key = key;
+    } else if (s->value == value) {
+        return true;
+    }
+    s->value = value;
+    s->dirty = true;
+    return true;
+}
+
+static struct record record(uint16_t key, uint32_t value)
+{
+    return (struct record){.key = key, .check = check(key, value), .value = value};
+}
+
+/* n records from slot on, all in the same page. Stalls everything, under a ms */
+static void program(unsigned s, unsigned slot, const struct record *r, unsigned n)
+{
+    static uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t offset = slot * sizeof(*r) % FLASH_PAGE_SIZE;
+    uint32_t page_start = slot * sizeof(*r) - offset;
+
+    //Programming ones leaves what is there
+    memset(page, 0xFF, sizeof(page));
+    memcpy(&page[offset], r, n * sizeof(*r));
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_program(STORE_FLASH_OFFSET + s * FLASH_SECTOR_SIZE + page_start, page, sizeof(page));
+    restore_interrupts(irq);
+}
+
+/* Copy the settings to the other sector, a page at a time. The header goes
+ * last: until then the log is where it was. */
+static void compact(void)
+{
+    struct record r[PAGE_SLOTS];
+    unsigned slot = 1 + copied, n = 0;
+
+    if (copied == n_settings) {
+        r[0] = record(HEADER, generation + 1);
+        program(!active, 0, r, 1);
+        active = !active;
+        generation++;
+        next_slot = slot;
+        other_erased = false;
+        compacting = false;
+        return;
+    }
+    while (copied < n_settings && n < PAGE_SLOTS - slot % PAGE_SLOTS) {
+        struct setting *s = &settings[copied++];
+        r[n++] = record(s->key, s->value);
+        s->dirty = false;
+    }
+    program(!active, slot, r, n);
+}
+
+/* A page worth of what was set, or a step of compacting */
+static void write_some(void)
+{
+    struct record r[PAGE_SLOTS];
+    unsigned n = 0;
+
+    if (compacting) {
+        compact();
+        return;
+    }
+    bool dirty = false;
+    for (unsigned i = 0; i < n_settings; i++)
+        dirty |= settings[i].dirty;
+    if (!dirty)
+        return;
+    if (next_slot >= SLOTS) {
+        //Full. The other one is erased first, when nobody minds
+        if (other_erased) {
+            compacting = true;
+            copied = 0;
+        }
+        return;
+    }
+    if (!next_slot) {
+        generation = 1;
+        r[n++] = record(HEADER, generation);
+    }
+    unsigned room = PAGE_SLOTS - next_slot % PAGE_SLOTS;
+    if (room > SLOTS - next_slot)
+        room = SLOTS - next_slot;
+    for (unsigned i = 0; i < n_settings && n < room; i++) {
+        if (!settings[i].dirty) continue;
+        r[n++] = record(settings[i].key, settings[i].value);
+        settings[i].dirty = false;
+    }
+    program(active, next_slot, r, n);
+    next_slot += n;
+}
+
+void store_cry(uint64_t t_now_us)
+{
+    t_cry = t_now_us;
+    if (events_seen != key_events_head) {
+        events_seen = key_events_head;
+        t_change = t_now_us;
+    }
+    write_some();
+}
+
+void store_task(uint64_t t_now_us)
+{
+    //Nothing to get in the way of without cries
+    if (t_now_us - t_cry > STORE_IDLE_US)
+        write_some();
+
+    if (other_erased || compacting || t_now_us - t_change < STORE_IDLE_US)
+        return;
+    //Stalls everything for tens of ms, the pack gets a fresh start after
+    akela_stop();
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(STORE_FLASH_OFFSET + !active * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    restore_interrupts(irq);
+    other_erased = true;
+    akela_init();
+}
+
+static void list(void)
+{
+    printf("store: sector %u, generation %lu, %u of %u records\n", active,
+            (unsigned long)generation, next_slot, (unsigned)SLOTS);
+    for (unsigned i = 0; i < n_settings; i++)
+        printf("store: 0x%03x %lu%s\n", settings[i].key, (unsigned long)settings[i].value,
+                settings[i].dirty ? " (not in flash yet)" : "");
+}
+
+bool store_console(int c)
+{
+    static char line[32];
+    static int len = -1;            //-1 when not reading a line
+
+    if (c < 0)
+        return false;
+    if (len < 0) {
+        if (c == 'c')
+            list();
+        else if (c == 'C')
+            len = 0;
+        else
+            return false;
+        return true;
+    }
+    if (c != '\r' && c != '\n') {
+        if (len < (int)sizeof(line) - 1)
+            line[len++] = c;
+        return true;
+    }
+    line[len] = 0;
+    len = -1;
+
+    char *end, *end_value;
+    unsigned long key = strtoul(line, &end, 0);
+    unsigned long value = strtoul(end, &end_value, 0);
+    if (end == line || end_value == end || key > 0xFFFF)
+        printf("store: C <key> <value>\n");
+    else if (!store_set(key, value))
+        printf("store: no room for 0x%03lx\n", key);
+    else
+        printf("store: 0x%03lx = %lu\n", key, value);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef AKELA_STORE_H
+#define AKELA_STORE_H
+/**
+ * Settings in flash, set from the console instead of akela_config.h
+ *
+ * A log of (key, value) records in the two sectors below the map of the
+ * topology. Setting one appends a record, the last one of a key wins. When
+ * the sector is full the settings are copied to the other one and the full
+ * one is erased. The settings are read into RAM once, at boot.
+ *
+ * Flash stalls everything while it is busy, code runs from it. Appending
+ * programs a page, under a ms: that happens right after a cry, before the
+ * next growl. An erase stalls for tens of ms: it waits until no key changed
+ * for STORE_IDLE_US and takes the pack while it is at it.
+ *
+ * On the console 'C' followed by "key value" and enter sets one, in decimal
+ * or 0x hex. 'c' lists them.
+ **/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The keys */
+#define STORE_KEYMAP        0x100   /* + rabi: HID usage of its key */
+#define STORE_LED_FADE_US   0x200   /* step down in brightness after a key up */
+#define STORE_PACK_TIMEOUT_US 0x300 /* akela_tune, see akela.h */
+#define STORE_WATCHDOG_US   0x301
+
+#define STORE_MAX       64          /* settings */
+#define STORE_IDLE_US   (2 * 1000 * 1000)
+
+void store_init(void);
+/* The value of key, dflt if it was never set */
+uint32_t store_get(uint16_t key, uint32_t dflt);
+/* Set in RAM, in flash soon. Returns false if there is no room for it */
+bool store_set(uint16_t key, uint32_t value);
+/* Returns true if it took the character */
+bool store_console(int c);
+/* After every cry, writes what was set */
+void store_cry(uint64_t t_now_us);
+/* While the Akela has the pack, for the erase or without a pack */
+void store_task(uint64_t t_now_us);
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Telemetry over the CDC interface. See librabi/telemetry.h for the format.
+ **/
+#include <string.h>
+
+#include "tusb.h"
+#include "akela.h"
+#include "akela_telemetry.h"
+
+struct telemetry telemetry;
+bool telemetry_enabled;
+
+static uint8_t seq;
+
+static bool send_record(enum tm_record type, const void *payload, uint16_t len)
+{
+    static uint8_t buf[TM_HEADER_LEN + TM_MAX_PAYLOAD + 2];
+    uint32_t total = TM_HEADER_LEN + len + 2;
+
+    //Never block the protocol loop, try again next period
+    if (tud_cdc_write_available() < total) return false;
+
+    buf[0] = TM_SYNC & 0xFF;
+    buf[1] = TM_SYNC >> 8;
+    buf[2] = type;
+    buf[3] = seq++;
+    buf[4] = len & 0xFF;
+    buf[5] = len >> 8;
+    memcpy(&buf[TM_HEADER_LEN], payload, len);
+    uint16_t sum = tm_fletcher16(&buf[2], TM_HEADER_LEN - 2 + len);
+    buf[TM_HEADER_LEN + len] = sum & 0xFF;
+    buf[TM_HEADER_LEN + len + 1] = sum >> 8;
+
+    tud_cdc_write(buf, total);
+    return true;
+}
+
+static bool send_hist(enum tm_record type, uint16_t bin_width, const uint32_t *hist, uint16_t bins)
+{
+    static uint32_t payload[1 + TM_MAX_PAYLOAD / 4];
+    //The RP2040 is little endian, just like the records
+    payload[0] = bin_width | (uint32_t)bins << 16;
+    memcpy(&payload[1], hist, bins * 4);
+    return send_record(type, payload, 4 + bins * 4);
+}
+
+void telemetry_task(uint64_t t_now_us)
+{
+    static uint64_t t_next;
+    static int next_record = TM_REC_COUNTERS;
+    uint32_t payload[1 + TM_N_COUNTERS];
+
+    if (!telemetry_enabled || t_now_us < t_next) return;
+
+    //One record per call so the protocol loop keeps running
+    switch (next_record) {
+        case TM_REC_COUNTERS:
+            telemetry.counters[TM_CRIES]     = akela_stats.cries;
+            telemetry.counters[TM_RESETS]    = akela_stats.resets;
+            telemetry.counters[TM_COOLDOWNS] = akela_stats.cooldowns;
+            telemetry.counters[TM_TIMEOUTS]  = akela_stats.timeouts;
+            telemetry.counters[TM_RESYNCS]   = akela_stats.resyncs;
+            telemetry.counters[TM_BAD_FRAMES] = akela_stats.bad_frames;
+            telemetry.counters[TM_RECOVERY_MAX_US] = akela_stats.recovery_max_us;
+            payload[0] = t_now_us / 1000;
+            memcpy(&payload[1], telemetry.counters, sizeof(telemetry.counters));
+            if (!send_record(TM_REC_COUNTERS, payload, sizeof(payload))) return;
+            next_record = TM_REC_CRY_HIST;
+            return;
+        case TM_REC_CRY_HIST:
+            if (!send_hist(TM_REC_CRY_HIST, TM_CRY_BIN_US, telemetry.cry_hist, TM_CRY_BINS)) return;
+            next_record = TM_REC_PULSE_HIST;
+            return;
+        case TM_REC_PULSE_HIST:
+            if (!send_hist(TM_REC_PULSE_HIST, TM_PULSE_BIN_NS, telemetry.pulse_hist, TM_PULSE_BINS)) return;
+            next_record = TM_REC_LATENCY_HIST;
+            return;
+        case TM_REC_LATENCY_HIST:
+            if (!send_hist(TM_REC_LATENCY_HIST, TM_LATENCY_BIN_US, telemetry.latency_hist, TM_LATENCY_BINS)) return;
+            tud_cdc_write_flush();
+            next_record = TM_REC_COUNTERS;
+            t_next = t_now_us + TELEMETRY_PERIOD_US;
+            return;
+    }
+}
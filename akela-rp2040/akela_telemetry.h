@@ -0,0 +1,52 @@
+#ifndef AKELA_TELEMETRY_H
+#define AKELA_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry.h"
+
+/* Seconds between two batches of records, when enabled */
+#define TELEMETRY_PERIOD_US (1000 * 1000)
+
+/* Only touched from the main loop. The counters are plain words so a reader
+ * in another context at worst sees a value that is one update behind. */
+struct telemetry {
+    uint32_t counters[TM_N_COUNTERS];
+    uint32_t cry_hist[TM_CRY_BINS];
+    uint32_t pulse_hist[TM_PULSE_BINS];
+    uint32_t latency_hist[TM_LATENCY_BINS];
+};
+extern struct telemetry telemetry;
+extern bool telemetry_enabled;
+
+static inline void telemetry_count(enum tm_counter c)
+{
+    telemetry.counters[c]++;
+}
+
+static inline void telemetry_hist(uint32_t *hist, int bins, uint32_t v)
+{
+    hist[v < bins ? v : bins - 1]++;
+}
+
+static inline void telemetry_pulse(uint32_t ns)
+{
+    telemetry_hist(telemetry.pulse_hist, TM_PULSE_BINS, ns / TM_PULSE_BIN_NS);
+}
+
+static inline void telemetry_cry(uint32_t us)
+{
+    telemetry_hist(telemetry.cry_hist, TM_CRY_BINS, us / TM_CRY_BIN_US);
+}
+
+static inline void telemetry_latency(uint32_t us)
+{
+    telemetry_hist(telemetry.latency_hist, TM_LATENCY_BINS, us / TM_LATENCY_BIN_US);
+    if (us > telemetry.counters[TM_LATENCY_MAX_US])
+        telemetry.counters[TM_LATENCY_MAX_US] = us;
+}
+
+/* Send a batch of records if enabled and it is time. */
+void telemetry_task(uint64_t t_now_us);
+
+#endif
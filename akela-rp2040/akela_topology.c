@@ -0,0 +1,101 @@
+/**
+ * The map of the pack in flash, with librabi/topology.c
+ **/
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "akela_topology.h"
+#include "akela.h"
+
+/* The last sector of the flash */
+#define TOPOLOGY_FLASH_OFFSET   (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define MAP_FLASH_SIZE \
+    ((sizeof(struct topology) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE)
+
+struct topology akela_topology;
+
+static enum {START, RUNNING, IDLE} state;
+static bool print;
+
+static void load(void)
+{
+    const struct topology *stored = (const struct topology *)(XIP_BASE + TOPOLOGY_FLASH_OFFSET);
+
+    memset(&akela_topology, 0, sizeof(akela_topology));
+    if (stored->magic == TOPOLOGY_MAGIC && stored->n <= W)
+        akela_topology = *stored;
+}
+
+/* Stalls everything for the erase, a few tens of ms */
+static void save(void)
+{
+    static uint8_t buf[MAP_FLASH_SIZE];
+
+    memset(buf, 0xFF, sizeof(buf));
+    memcpy(buf, &akela_topology, sizeof(akela_topology));
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(TOPOLOGY_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(TOPOLOGY_FLASH_OFFSET, buf, sizeof(buf));
+    restore_interrupts(irq);
+}
+
+static void print_map(void)
+{
+    for (uint32_t i = 0; i < akela_topology.n; i++) {
+        const uint32_t *uid = akela_topology.uid[i];
+        printf("topology: %2lu %08lx%08lx%08lx%08lx", (unsigned long)i,
+                (unsigned long)uid[0], (unsigned long)uid[1],
+                (unsigned long)uid[2], (unsigned long)uid[3]);
+        if (topology_from[i] < 0)
+            printf(" new\n");
+        else if (topology_from[i] != (int)i)
+            printf(" was %d\n", topology_from[i]);
+        else
+            printf("\n");
+    }
+}
+
+bool topology_console(int c)
+{
+    if (c != 'M' || state == RUNNING)
+        return false;
+    state = START;
+    print = true;
+    return true;
+}
+
+bool topology_task(uint64_t t_now_us, int rabies)
+{
+    static bool loaded;
+
+    //Wait for the pack to answer a poll
+    if (state == IDLE || (state == START && !rabies))
+        return false;
+    if (state == START) {
+        if (!loaded) {
+            load();
+            loaded = true;
+        }
+        akela_stop();
+        topology_start(&akela_topology, rabies);
+        state = RUNNING;
+    }
+
+    enum topology_result r = topology_step(t_now_us);
+    if (r == TOPOLOGY_BUSY)
+        return true;
+
+    printf("topology: %s, %lu rabies, %d moved, %d new, %lu messages\n",
+            r == TOPOLOGY_SAME ? "same" : r == TOPOLOGY_CHANGED ? "changed" : "failed",
+            (unsigned long)akela_topology.n, topology_stats.moved, topology_stats.found,
+            (unsigned long)topology_stats.messages);
+    if (r == TOPOLOGY_CHANGED)
+        save();
+    if (r != TOPOLOGY_FAILED && (print || r == TOPOLOGY_CHANGED))
+        print_map();
+    print = false;
+    state = IDLE;
+    akela_init();
+    return false;
+}
@@ -0,0 +1,21 @@
+#ifndef AKELA_TOPOLOGY_H
+#define AKELA_TOPOLOGY_H
+/**
+ * The map of the pack in flash, see librabi/topology.h
+ *
+ * Checked against the pack once it first answers a poll. 'M' on the console
+ * does it again and prints it.
+ **/
+#include <stdint.h>
+#include <stdbool.h>
+#include "topology.h"
+
+/* As it was last checked, empty if it never was */
+extern struct topology akela_topology;
+
+/* Returns true if it took the character */
+bool topology_console(int c);
+/* Returns true while it has the pack to itself */
+bool topology_task(uint64_t t_now_us, int rabies);
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * Firmware update of the pack from the console, with librabi/update.c
+ **/
+#include <stdio.h>
+#include "akela_update.h"
+#include "akela.h"
+#include "update.h"
+
+static enum {IDLE, SIZE, IMAGE, RUNNING} state;
+static uint8_t image[UPDATE_PAGES_MAX * BULK_PAGE_SIZE];
+static uint32_t size, received;
+static int pack_rabies;
+static uint64_t t_last_rx, t_start;
+static uint32_t last_rounds, last_page;
+
+static void start(uint64_t t_now_us)
+{
+    akela_stop();
+    if (!update_start(image, size, pack_rabies)) {
+        printf("update: bad size %lu\n", (unsigned long)size);
+        state = IDLE;
+        return;
+    }
+    printf("update: %u pages to %d rabies\n", update_stats.pages, pack_rabies);
+    last_rounds = last_page = 0;
+    t_start = t_now_us;
+    state = RUNNING;
+}
+
+bool update_console(int c, uint64_t t_now_us, int rabies)
+{
+    if (c < 0)
+        return false;
+
+    switch (state) {
+        case IDLE:
+            if (c != 'U')
+                return false;
+            size = received = 0;
+            pack_rabies = rabies;
+            state = SIZE;
+            break;
+        case SIZE:
+            size |= (uint32_t)c << (8 * received++);
+            if (received < 4)
+                break;
+            if (!size || size > sizeof(image)) {
+                printf("update: bad size %lu\n", (unsigned long)size);
+                state = IDLE;
+                break;
+            }
+            received = 0;
+            state = IMAGE;
+            break;
+        case IMAGE:
+            image[received++] = c;
+            if (received == size)
+                start(t_now_us);
+            break;
+        case RUNNING:
+            //Nothing goes while we are at it
+            break;
+    }
+    t_last_rx = t_now_us;
+    return true;
+}
+
+bool update_task(uint64_t t_now_us)
+{
+    if ((state == SIZE || state == IMAGE) && t_now_us - t_last_rx > UPDATE_RX_TIMEOUT_US) {
+        printf("update: timeout, %lu of %lu bytes\n", (unsigned long)received, (unsigned long)size);
+        state = IDLE;
+    }
+    if (state != RUNNING)
+        return false;
+
+    enum update_result r = update_step(t_now_us);
+
+    if (update_stats.rounds != last_rounds) {
+        last_rounds = update_stats.rounds;
+        printf("update: verify %lu, %d of %d rabies have it, %d run it\n",
+                (unsigned long)last_rounds, update_stats.rabies_done,
+                update_stats.rabies, update_stats.rabies_running);
+    }
+    if (update_stats.page != last_page && !(update_stats.page % 16)) {
+        last_page = update_stats.page;
+        printf("update: page %u of %u\n", last_page, update_stats.pages);
+    }
+    if (r == UPDATE_BUSY)
+        return true;
+
+    printf("update: %s in %lu ms, %lu messages, %lu pages sent, %lu bad echoes\n",
+            r == UPDATE_DONE ? "done" : "failed",
+            (unsigned long)((t_now_us - t_start) / 1000),
+            (unsigned long)update_stats.messages,
+            (unsigned long)update_stats.pages_sent,
+            (unsigned long)update_stats.bad_echoes);
+    state = IDLE;
+    akela_init();
+    return false;
+}
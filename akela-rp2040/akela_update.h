@@ -0,0 +1,20 @@
+#ifndef AKELA_UPDATE_H
+#define AKELA_UPDATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Firmware update of the pack from the console: 'U', the size of the image
+ * as 4 bytes little endian, then the image. Progress goes back as lines of
+ * text starting with "update:", tools/rabi_update does all that. */
+#define UPDATE_RX_TIMEOUT_US (2 * 1000 * 1000)
+
+/* Feed it the console, returns true if c was for us. rabies is the size of
+ * the pack in the last cry. */
+bool update_console(int c, uint64_t t_now_us, int rabies);
+
+/* Run the update, returns true while it has the pack. Call akela_step()
+ * when it does not. */
+bool update_task(uint64_t t_now_us);
+
+#endif
@@ -7,8 +7,17 @@
 #include "hardware/pio.h"
 #include "hardware/gpio.h"
 #include "hardware/clocks.h"
+#include "hardware/timer.h"
 #include "ws2812.pio.h"
 #include "rabi.pio.h"
+#include "akela.h"
+#include "akela_telemetry.h"
+#include "akela_capture.h"
+#include "akela_update.h"
+#include "akela_topology.h"
+#include "akela_encoder.h"
+#include "akela_latency.h"
+#include "akela_store.h"
 #include "bsp/board.h"
 #include "tusb.h"
 #include "usb_descriptors.h"
@@ -24,9 +33,6 @@
 #define RB_LISTEN_SM 0
 #define RB_HOWL_SM 1
 
-#define K 1             /* Number if inputs per RABI */
-#define W 25            /* Number of RABIs */
-
 #define KEYMAP_LEN 26
 static const uint8_t key_mapping[KEYMAP_LEN] = {
     HID_KEY_A, HID_KEY_B, HID_KEY_C, HID_KEY_D, HID_KEY_E,
@@ -39,16 +45,7 @@ static const uint8_t key_mapping[KEYMAP_LEN] = {
 
 void hid_task(absolute_time_t t_now_us);
 
-uint8_t led_states[W];
-
-//Two buffers holding the key state. Once a full message is received
-//we flip the buffers so we do not get spurious key toggles while receiving
-//a message. Later we might compare the 2 to get key up and down events.
-uint8_t key_states_a[W];
-uint8_t key_states_b[W];
-uint8_t *key_states_read = key_states_a;
-uint8_t *key_states_write = key_states_b;
-uint8_t key_states_events[W];
+uint latency_last_us, latency_max_us;
 
 bool caps_lock = false;
 
@@ -93,24 +90,87 @@ uint8_t pulse(uint8_t i, uint8_t n, absolute_time_t now)
     return clamp((sinf((float)(now/4000.0))*128)+128, 0, 255);
 }
 
-// Do full brightness on key down. Fade out on key up.
-void update_leds(uint n, absolute_time_t now)
+/* The strip is a chain: a frame of n colours sets the first n LEDs, the
+ * others keep theirs. So only the LEDs up to the last one that changed go
+ * out, and nothing if none did. From the main loop, a FIFO full at a time,
+ * leds_task() does not wait for the strip. There is an LED for every rabi. */
+#define LED_FADE_STEP_US 2000   //a step down in brightness on key up, or STORE_LED_FADE_US
+#define LED_FRAME_US    20000   //between animation frames
+
+static uint32_t leds_frame[W];  //what the LEDs should show
+static uint32_t leds_sent[W];   //what they show, or will once sent
+static bool leds_dirty;         //a colour in leds_frame changed
+static uint leds_next, leds_end;
+
+static void leds_send(void)
+{
+    while (leds_next < leds_end && !pio_sm_is_tx_fifo_full(WS_PIO, WS_SM))
+        pio_sm_put(WS_PIO, WS_SM, leds_sent[leds_next++]);
+}
+
+static void leds_set(uint i, uint32_t grba)
+{
+    if (leds_frame[i] == grba)
+        return;
+    leds_frame[i] = grba;
+    leds_dirty = true;
+}
+
+//Send the LEDs that changed. A frame still going out goes first, the
+//reset gap of the strip is long over by the next one.
+static void leds_show(uint n)
 {
-    const int dec = 10;
+    if (!leds_dirty || leds_next < leds_end)
+        return;
+    leds_dirty = false;
+    uint end = 0;
     for (uint i = 0; i < n; ++i) {
-        if (key_states_read[i]) {
-            led_states[i] = 0xFF;
-        } else if (led_states[i] > dec) {
-            led_states[i] -= dec;
-        } else {
-            led_states[i] = 0;
+        if (leds_frame[i] != leds_sent[i]) {
+            leds_sent[i] = leds_frame[i];
+            end = i + 1;
         }
     }
+    leds_next = 0;
+    leds_end = end;
+    leds_send();
+}
+
+// Do full brightness on key down. Fade out on key up.
+// A tap between two updates still flashes.
+void update_leds(uint n, absolute_time_t now)
+{
+    static uint32_t events_tail;
+    static bool held[W];
+    static absolute_time_t t_up[W];
+    uint64_t fade = store_get(STORE_LED_FADE_US, LED_FADE_STEP_US);
+    struct key_event e;
+    int got;
+
+    if (leds_next < leds_end)
+        return;
+    while ((got = key_event_next(&events_tail, &e)) == 1) {
+        held[e.rabi] = e.down;
+        if (!e.down)
+            t_up[e.rabi] = e.t_us;
+    }
+    if (got == -1)
+        for (uint i = 0; i < W; ++i)
+            held[i] = KEY_LEVEL(key_states_read[i]);
+
     for (uint i = 0; i < n; ++i) {
-        uint8_t r = 0;
-        uint8_t g = 0;
         uint8_t b = 0;
+        if (held[i] && !encoder_at(i)) {
+            b = 0xFF;
+        } else if (now - t_up[i] < 0xFF * fade) {
+            b = 0xFF - (now - t_up[i]) / fade;
+        }
+        if (b) {
+            leds_set(i, (0<<16) | (0<<24) | (b<<8));
+            continue;
+        }
 
+        uint8_t r = 0;
+        uint8_t g = 0;
         if (!caps_lock) {
             r = knight_rider(i, n, now);
             g = 5;
@@ -118,50 +178,76 @@ void update_leds(uint n, absolute_time_t now)
             r = pulse(i, n, now);
             g = pulse(i, n, now+1333);
         }
-        b = led_states[i];
-        uint32_t grba;
-        if (b) {
-            grba = (0<<16) | (0<<24) | (b<<8);
-        } else {
-            grba = (r<<16) | (g<<24) | (b<<8);
-        }
-        pio_sm_put_blocking(WS_PIO, WS_SM, grba);
+        leds_set(i, (r<<16) | (g<<24) | (b<<8));
+    }
+    leds_show(n);
+}
+
+//From the main loop, out of the way of the cries
+static void leds_task(absolute_time_t now)
+{
+    static absolute_time_t t_next = 0;
+
+    if (now > t_next) {
+        t_next = now + LED_FRAME_US;
+        update_leds(W, now);
     }
+    leds_send();
 }
 
 void set_leds_uniform(uint32_t grba)
 {
+    while (leds_next < leds_end)
+        leds_send();
     for (uint i = 0; i < W; ++i) {
-        pio_sm_put_blocking(WS_PIO, WS_SM, grba);
+        leds_set(i, grba);
     }
+    leds_show(W);
 }
 void set_leds_red()   { set_leds_uniform(0x00FF0000); }
 void set_leds_blue()  { set_leds_uniform(0x0000FF00); }
 void set_leds_green() { set_leds_uniform(0xFF000000); }
 void set_leds_yellow(){ set_leds_uniform(0xFF00FF00); }
 
-// Flip read and write buffer
-void flip()
+#if SCAN_US
+static int growl_alarm;
+
+/* The PIO is idle between cries, the growl fits its TX fifo */
+static void growl_now(uint alarm)
 {
-    if (key_states_read == key_states_a) {
-        key_states_read  = key_states_b;
-        key_states_write = key_states_a;
-    } else {
-        key_states_read  = key_states_a;
-        key_states_write = key_states_b;
-    }
-    for (int i = 0; i < W; i++) {
-        key_states_events[i] = key_states_a[i]^key_states_b[i];
-    }
-    memset(key_states_write, 0, W);
+    pio_sm_put(RB_PIO, RB_HOWL_SM, 1);
+    pio_sm_put(RB_PIO, RB_HOWL_SM, 1);
+}
+
+void akela_growl_at(uint64_t t_us)
+{
+    hardware_alarm_cancel(growl_alarm);
+    //True if that time has passed already
+    if (t_us && hardware_alarm_set_target(growl_alarm, from_us_since_boot(t_us)))
+        growl_now(growl_alarm);
+}
+
+static void scan_init(void)
+{
+    growl_alarm = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(growl_alarm, growl_now);
 }
+#endif
 
-/* Frequency of the input counter. Keep above 24Mhz to be on par with Rabi.
- * Also keep an integer multiple of 125Mhz (FCPU) */
-#define FREQ_RB_COUNT   (25 * 1000 * 1000)
+//The timeouts of the Akela from the settings, at boot and when one is set
+static void tune(void)
+{
+    akela_tune.pack_timeout_us = store_get(STORE_PACK_TIMEOUT_US, 0);
+    akela_tune.watchdog_us = store_get(STORE_WATCHDOG_US, 0);
+}
+
+/* Ticks of the input counter, set by howl_count_init(). In ns 16.16 fixed point */
+static uint32_t ns_per_tick_q16;
 
 static void setup()
 {
+    store_init();
+    tune();
     stdio_init_all();
     board_init(); //something for tinyUSB
     tusb_init();
@@ -171,218 +257,118 @@ static void setup()
     ws2812_program_init(WS_PIO, WS_SM, ws_addr, LED_OUT_PIN, 800000, false);
 
     //PIO 1 handles the rabies
-    //25_000_000 Hz => 40ns
+    //at 125_000_000 Hz a tick is 16ns
     uint rb_count_addr = pio_add_program(RB_PIO, &howl_count_program);
-    howl_count_init(RB_PIO, RB_LISTEN_SM, rb_count_addr, KEY_IN_PIN, FREQ_RB_COUNT);
+    uint32_t tick_hz = howl_count_init(RB_PIO, RB_LISTEN_SM, rb_count_addr, KEY_IN_PIN);
+    ns_per_tick_q16 = (1000000000ull << 16) / tick_hz;
 
     //statemachine 1 initiates cry when data in TX queue
     uint rb_howl_addr = pio_add_program(RB_PIO, &howl_start_program);
     howl_start_program_init(RB_PIO, RB_HOWL_SM, rb_howl_addr, KEY_OUT_PIN, 1000 * 1000);
 
+    capture_init(tick_hz);
+    latency_init();
+#if SCAN_US
+    scan_init();
+#endif
 }
 
-//return:
-//-1 error, reset me!
-// 0 still busy, expecting more data. Feed me!
-// 1 done. Seen n rabies
-int statemachine(bool bit, bool reset, int *n_rabies)
-{
-    static uint input_id, wolf_id, state = 0;
-
-    /*
-      " Everyone knows that debugging is twice as hard as writing
-        a program in the first place. So if you're as clever as
-        you can be when you write it, how will you ever debug it? "
-                                               -- Brian Kernighan
-    */
-
-    if (reset) {
-        state = 0;
-        return 0;
-    }
 
-    switch (state) {
-        case 0:                     //wait for wakeup
-            wolf_id = -1;
-            if (bit) {
-                state = 1;
-            } else {
-                //something wrong. we should reset.
-                state = 0;
-                return -1;
-            }
-            return 0;
-        case 1:                     //recv next header
-            if (bit) {
-                state = 0;
-                *n_rabies = wolf_id+1;
-                return 1; //return number of rabies spotted
-            }
-            state = 2;
-            input_id = K;           //we expect to rcv K bits from neighbor
-            wolf_id++;
-            return 0;
-        case 2:                     //read 1 of K bits
-            key_states_write[wolf_id] <<= 1;
-            key_states_write[wolf_id] |= bit;
-            if (--input_id) {
-                return 0; //stay in this state
-            } else {
-                state = 1; //go listen for next rabi
-                return 0;
-            }
-    }
-}
+#define tick_to_ns(_ti)   ((uint32_t)(((uint64_t)(_ti) * ns_per_tick_q16) >> 16))
+
+/* Hooks for akela.c */
+bool akela_data_ready(void) { return !pio_sm_is_rx_fifo_empty(RB_PIO, RB_LISTEN_SM); }
 
+int akela_read(void)
+{
+    if (pio_sm_is_rx_fifo_full(RB_PIO, RB_LISTEN_SM))
+        telemetry_count(TM_RX_FIFO_FULL);
+    uint32_t t = pio_sm_get(RB_PIO, RB_LISTEN_SM);
+    uint32_t ns = tick_to_ns(t);
+    capture_pulse(t);
+    telemetry_pulse(ns);
+    if (!pulse_known(ns))
+        telemetry_count(TM_UNKNOWN_PULSES);
+    return timing_to_bit(ns);
+}
 
-#define OPS_PER_TICK 2 //depends on howl_count program
-#define us_to_tick(_us)   ((uint32_t)(_us * (1e-6 / ((float)OPS_PER_TICK / FREQ_RB_COUNT))))
-#define tick_to_ns(_ti)   ((uint32_t)(_ti * (OPS_PER_TICK * 1000 / ( FREQ_RB_COUNT / 1000000))))
-
-#define T1US_IN_TICKS   us_to_tick(1)
-#define TRESET_TICKS    us_to_tick(TRESET * 2)
-#define T0H_TICKS       us_to_tick(T0H)
-#define T0L_TICKS       us_to_tick(T0L)
-#define T1H_TICKS       us_to_tick(T1H)
-#define T1L_TICKS       us_to_tick(T1L)
-/* Only to be called after receive_bits_available returned true!
- * Returns:
- *  -2 for error
- *  -1 for reset
- *   0 for a zero bit
- *   1 for a one bit
- */
-static int timing_to_bit(uint32_t t)
+void akela_write(int bit)
 {
-    /* TODO define a proper margin. 10 ticks seems to work, more is better I guess */
-    /*printf("pulse length %d %d\r\n", t, tick_to_ns(t));*/
-    if (t > 400) return -1;
-    if (t > 190) return 1;
-    return 0;
-    /*switch (t) {//126 313*/
-        /*case T0H_TICKS - 20 ... T0H_TICKS + 3 * T1US_IN_TICKS:*/
-            /*return 0;*/
-        /*case T1H_TICKS - 10 ... T1H_TICKS + 3 * T1US_IN_TICKS:*/
-            /*return 1;*/
-        /*case (TRESET_TICKS - 3 * T1US_IN_TICKS ) ... (TRESET_TICKS + 3 * T1US_IN_TICKS):*/
-            /*return -1; //Reset*/
-        /*default:*/
-            /*printf("Unknown pulse length %d %d\r\n", t, tick_to_ns(t));*/
-            /*return -2; //panic, unknown byte length?*/
-
-    /*}*/
+    if (bit == RESET_MSG)
+        capture_marker(CAP_RESET, time_us_32());
+    if (pio_sm_is_tx_fifo_full(RB_PIO, RB_HOWL_SM))
+        telemetry_count(TM_TX_FIFO_FULL);
+    pio_sm_put_blocking(RB_PIO, RB_HOWL_SM, bit);
 }
 
-#define WATCHDOG_TIMEOUT (100 * 1000)  /* uS after which the watchdog intervenes */
-
-#define RESET_WATCHDOG() t_watch_dog = t_now_us + WATCHDOG_TIMEOUT
-#define DATA_READY()     !pio_sm_is_rx_fifo_empty(RB_PIO, RB_LISTEN_SM)
-#define READ()           timing_to_bit(pio_sm_get(RB_PIO, RB_LISTEN_SM))
-#define WRITE(_bit)      pio_sm_put_blocking(RB_PIO, RB_HOWL_SM, _bit)
-#define SEND_RESET()     pio_sm_put_blocking(RB_PIO, RB_HOWL_SM, -1); if (0) printf("RESET\n")
-#define RESET_MSG        (-1)
-#define ERROR_MSG        (-2)
-
-#define GOTO_RESET() {\
-    if (0) set_leds_red();\
-    RESET_WATCHDOG();\
-    state = STATE_RESET;\
-    SEND_RESET();\
-    break;\
+void akela_cry_start(uint64_t t_now_us)
+{
+    capture_marker(CAP_CRY, t_now_us);
 }
-#define GOTO_COOLDOWN() {\
-    if (0) set_leds_yellow();\
-    RESET_WATCHDOG();\
-    state = STATE_COOLDOWN;\
-    break;\
+
+static int pack_rabies;
+
+void akela_cry_done(uint64_t t_now_us, int n_rabies)
+{
+    pack_rabies = n_rabies;
+    telemetry_cry(akela_stats.cry_last_us);
+    encoder_cry(n_rabies);
+    latency_cry(t_now_us);
+    hid_task(t_now_us);
+    store_cry(t_now_us);
 }
-#define GOTO_GOOD() {\
-    if (0) set_leds_green();\
-    RESET_WATCHDOG();\
-    state = STATE_GOOD;\
-    (void)statemachine(0, true, NULL);\
-    WRITE(1);\
-    WRITE(1);\
-    break;\
+
+#if STREAM
+void akela_stream(uint64_t t_now_us)
+{
+    latency_cry(t_now_us);
+    hid_task(t_now_us);
 }
+#endif
 
 int main()
 {
-    enum states {STATE_GOOD, STATE_COOLDOWN, STATE_RESET};
-    int state;
-    int good_cnt = 0;
-    absolute_time_t t_watch_dog = 0;
-    absolute_time_t t_led_task = 0;
+    absolute_time_t t_log = 0;
 
     setup();
-
-    state = STATE_COOLDOWN;
+    akela_init();
 
     while (1) {
         tud_task(); // tinyusb device task, do always. otherwise we do not have serial debug
         absolute_time_t t_now_us = get_absolute_time(); //us
+        //An update or the map has the pack to itself
+        if (!update_task(t_now_us) && !topology_task(t_now_us, pack_rabies)) {
+            akela_step(t_now_us);
+            store_task(t_now_us);
+        }
+        telemetry_task(t_now_us);
+        capture_task();
+        leds_task(t_now_us);
+
+        //'T' on the console starts the telemetry records, 't' stops them.
+        //'U' starts a firmware update of the pack, 'M' maps it
+        //'C' and 'c' set and list the settings in flash
+        int c = getchar_timeout_us(0);
+        if (store_console(c)) {
+            tune();
+        } else if (!update_console(c, t_now_us, pack_rabies) && !topology_console(c)) {
+            if (c == 'T') telemetry_enabled = true;
+            if (c == 't') telemetry_enabled = false;
+        }
 
-        switch (state) {
-            // In the GOOD state we are happy.
-            // We initiated a new transmission
-            // and are now waiting for all data.
-            case STATE_GOOD:
-                if (t_now_us > t_watch_dog) GOTO_RESET(); //we expect data, but got silence. Do reset.
-                if (!DATA_READY()) break;                 //still waiting for data
-
-                uint32_t data = READ();                   //
-                if (data == RESET_MSG) GOTO_COOLDOWN();       //unsolicited reset, someone must have panicked
-                if (data == ERROR_MSG) GOTO_COOLDOWN();   //now I'm panicking!
-
-                int n;
-                int r = statemachine(data, false, &n);  //feed it to our statemachine
-                if (r==-1) GOTO_RESET();                //statemachine indicated it is confused.
-                good_cnt++;
-                if( good_cnt % 10000 == 0){
-                    printf("Happy for %d\n", good_cnt);
-                }
-                if (!r) {
-                    RESET_WATCHDOG();                   //data received but not done yet, watchdog takes chillpill
-                    break;
-                }
-                //We are done! we recvd a good cry. Now do other stuff.
-                //TODO we never get here...
-                //
-                /*printf("Seen %d rabies in transmission\n", n);*/
-                flip();
-                hid_task(t_now_us);
-                if (t_now_us > t_led_task) {
-                    t_led_task = t_now_us + 20000;
-                    update_leds(25, t_now_us);
-                }
-                //Now we have done stuff do a sanity check and check we
-                //did not received any data in the mean time.
-                if (DATA_READY()) {
-                    GOTO_RESET();                   //shit, something is wrong
-                } else {
-                    GOTO_GOOD();                    //everybody agrees!
-                }
-
-            // Shit has gone sour. Lets wait until we see no more
-            // activity at all for at least WDT. Then we reset everyone
-            // so we are all on the same page.
-            case STATE_COOLDOWN:
-                if(good_cnt > 0) {
-                    printf("Good count is %d\n", good_cnt);
-                    good_cnt = 0;
-                }
-                if (t_now_us > t_watch_dog) GOTO_RESET(); //No yapping heard. Good. Do reset.
-                if (!DATA_READY()) break;                 //Everyone is still silent. Good
-                (void)READ();                             //Hush!
-                GOTO_COOLDOWN();                          //Someone ruined it, now we all need to wait again.
-
-            // We've send a RESET_MSG. Now listen for a RESET_MSG.
-            // If we hear something else we go back to the cooldown.
-            case STATE_RESET:
-                if (t_now_us > t_watch_dog) GOTO_RESET(); //RESET_MSG not recieved in time, send another
-                if (!DATA_READY()) break;                 //I guess we have to wait
-                if (READ() != RESET_MSG) GOTO_COOLDOWN();     //Some rabi is still yapping, send him to the icebox!
-                GOTO_GOOD();                              //All aboard!
+        if (t_now_us > t_log) {
+            t_log = t_now_us + 10 * 1000 * 1000;
+            printf("latency %u us (max %u), recovery %lu us (max %lu), resyncs %lu, cooldowns %lu\n",
+                    latency_last_us, latency_max_us,
+                    (unsigned long)akela_stats.recovery_last_us,
+                    (unsigned long)akela_stats.recovery_max_us,
+                    (unsigned long)akela_stats.resyncs,
+                    (unsigned long)akela_stats.cooldowns);
+            if (SCAN_US)
+                printf("scan %lu us, busy %lu us, overruns %lu\n",
+                        (unsigned long)akela_stats.scan_us,
+                        (unsigned long)akela_stats.scan_busy_us,
+                        (unsigned long)akela_stats.scan_overruns);
         }
     }
 }
@@ -399,27 +385,131 @@ void tud_suspend_cb(bool remote_wakeup_en) { }
 void tud_resume_cb(void) { }
 
 
+//The keys in the report, rabies in the order they went down
+static int hid_keys[6];
+static int hid_n;
+//Held, but the report was full
+static bool hid_waiting[W];
+
+//Lost track of the events, start over from the key levels
+static void hid_keys_resync(void)
+{
+    hid_n = 0;
+    for (int i = 0; i < W; i++) {
+        hid_waiting[i] = KEY_LEVEL(key_states_read[i]) && !encoder_at(i);
+        if (!hid_waiting[i] || hid_n == 6) continue;
+        hid_waiting[i] = false;
+        int p = hid_n++;
+        for (; p > 0 && key_edge_us[hid_keys[p-1]] > key_edge_us[i]; p--)
+            hid_keys[p] = hid_keys[p-1];
+        hid_keys[p] = i;
+    }
+}
+
+//A slot came free, the key that waited the longest gets it
+static bool hid_keys_refill(void)
+{
+    int w = -1;
+    for (int i = 0; i < W; i++)
+        if (hid_waiting[i] && (w < 0 || key_edge_us[i] < key_edge_us[w]))
+            w = i;
+    if (w < 0)
+        return false;
+    hid_waiting[w] = false;
+    hid_keys[hid_n++] = w;
+    return true;
+}
+
+//Apply the key events to the report. A key that went down since the last
+//report and up again stops it there, the host gets to see it down first.
+//Returns true if the report changed.
+static bool hid_keys_update(void)
+{
+    static uint32_t events_tail;
+    unsigned fresh = 0;             //slots that went down since the last report
+    bool changed = false;
+    struct key_event e;
+
+    while (1) {
+        uint32_t tail = events_tail;
+        int r = key_event_next(&tail, &e);
+        if (r == 0)
+            break;
+        if (r == -1) {
+            hid_keys_resync();
+            events_tail = tail;
+            return true;
+        }
+        if (encoder_at(e.rabi)) {
+            events_tail = tail;
+            continue;
+        }
+        int p = 0;
+        while (p < hid_n && hid_keys[p] != e.rabi)
+            p++;
+        if (e.down) {
+            //More than 6, it waits for a free slot
+            if (p == hid_n && hid_n < 6) {
+                fresh |= 1u << hid_n;
+                hid_keys[hid_n++] = e.rabi;
+                changed = true;
+            } else if (p == hid_n) {
+                hid_waiting[e.rabi] = true;
+            }
+        } else if (p == hid_n) {
+            hid_waiting[e.rabi] = false;
+        } else {
+            unsigned below = (1u << p) - 1;
+            if (fresh & (1u << p))
+                break;
+            hid_n--;
+            for (int q = p; q < hid_n; q++)
+                hid_keys[q] = hid_keys[q+1];
+            fresh = (fresh & below) | (fresh >> 1 & ~below);
+            if (hid_keys_refill())
+                fresh |= 1u << (hid_n - 1);
+            changed = true;
+        }
+        events_tail = tail;
+    }
+    return changed;
+}
+
 void hid_task(absolute_time_t t_now_us)
 {
     static absolute_time_t t_next = 0;
     if ( t_now_us < t_next) return;
-    t_next = t_now_us + 10000; //every 10 ms
 
     if ( !tud_hid_ready() ) return;
 
-    uint8_t pressed_keys[6] = { 0 };
-
-    for (int i = 0, j = 0; i < W; i++) {
-        if (key_states_read[i]) {
-            pressed_keys[j++] = key_mapping[i%KEYMAP_LEN];
-        }
-        if (j >= 6) break;
+    if (!hid_keys_update()) {
+        t_unreported_edge = 0;      //an encoder, or a key that did not fit
+        latency_cancel();
+        //Nothing for the keyboard, the encoders can have it. After a
+        //keyboard report they go from its complete callback
+        encoder_report();
+        return;
     }
+    //At most every 10 ms, the first change after a quiet spell right away
+    t_next = t_now_us + 10000;
+
+    uint8_t pressed_keys[6] = { 0 };
+    for (int p = 0; p < hid_n; p++)
+        pressed_keys[p] = store_get(STORE_KEYMAP + hid_keys[p], key_mapping[hid_keys[p]%KEYMAP_LEN]);
 
     uint8_t mods = 0;
     if (caps_lock)
         mods |= KEYBOARD_MODIFIER_LEFTSHIFT;
     tud_hid_keyboard_report(REPORT_ID_KEYBOARD, 0, pressed_keys);
+    latency_report();
+
+    //Time from the key edge at the rabi until its report leaves
+    if (t_unreported_edge) {
+        latency_last_us = t_now_us - t_unreported_edge;
+        if (latency_last_us > latency_max_us)
+            latency_max_us = latency_last_us;
+        t_unreported_edge = 0;
+    }
 }
 
 // Invoked when sent REPORT successfully to host
@@ -428,8 +518,12 @@ void hid_task(absolute_time_t t_now_us)
 void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len)
 {
   (void) instance;
-  (void) report;
   (void) len;
+
+  if (report[0] == REPORT_ID_KEYBOARD)
+    latency_done(time_us_64());
+  //The encoders go after the keyboard, a report at a time
+  encoder_report();
 }
 
 // Invoked when received GET_REPORT control request
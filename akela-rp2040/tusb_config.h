@@ -96,7 +96,7 @@
 
 //------------- CLASS -------------//
 #define CFG_TUD_HID               1
-#define CFG_TUD_CDC               1
+#define CFG_TUD_CDC               2 // console and pulse capture
 #define CFG_TUD_MSC               0
 #define CFG_TUD_MIDI              0
 #define CFG_TUD_VENDOR            0
@@ -105,7 +105,8 @@
 #define CFG_TUD_HID_EP_BUFSIZE    16
 
 #define CFG_TUD_CDC_RX_BUFSIZE   (64)
-#define CFG_TUD_CDC_TX_BUFSIZE   (64)
+// Large enough for a telemetry record, see akela_telemetry.c
+#define CFG_TUD_CDC_TX_BUFSIZE   (512)
 
 #ifdef __cplusplus
  }
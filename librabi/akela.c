@@ -3,102 +3,441 @@
  * Master implementation: "Akela"
  **/
 
-#include "wolf.h"
+#include <stdio.h>
+#include <string.h>
+#include "akela.h"
+#include "canine.h"
 
-#define output PIN1
-#define input PIN2
+//Rounded up to whole words for flip(), the bytes beyond W stay 0
+#define W_WORDS ((W + 3) / 4)
+uint8_t key_states_a[W_WORDS * 4];
+uint8_t key_states_b[W_WORDS * 4];
+uint8_t *key_states_read = key_states_a;
+uint8_t *key_states_write = key_states_b;
+uint64_t key_edge_us[W];
+uint64_t t_unreported_edge;
+struct key_event key_events[KEY_EVENTS];
+uint32_t key_events_head;
 
-#define W 100
-int rabies_A[W];
-int rabies_B[W];
-int *rabies[W]; //points to A or B
+struct akela_stats akela_stats;
+struct akela_tune akela_tune;
+uint32_t rabi_bad_frames[W];
 
-/* Statemachine state */
-int state;
-int rabi_i;
-int bark_i;
+//Bits of the cry so far, and up to the end of the frame of every rabi
+static unsigned cry_bits;
+static unsigned frame_end[W];
 
-void reset_statemachine()
+#if STREAM
+//The keys as the events told them, ahead of key_states_read
+static uint8_t key_told[W_WORDS * 4];
+static uint64_t t_rx_us;        //of the bit statemachine() is at
+//A slipped bit shifts the frames after it, they can still look fine.
+//Only frames where the last good cry had them go out early: at the same
+//bit and within half a bit time, the bits after a slip come a bit time
+//late or early. Nor after a bad frame, the rest is left to flip().
+static unsigned frame_end_good[W];
+static uint32_t frame_us[W], frame_us_good[W];   //from the first bit
+static uint64_t t_first_bit;
+static bool cry_bad;            //a bad frame in this cry so far
+#endif
+
+//The key level of the 4 frames in a word
+#define WORD_LEVELS(_w) ((_w) & 0x01010101u * (1u << (K - 1)))
+
+static void key_event(int i, bool down, uint64_t t_us)
 {
-    state = S_REST;
-    rabi_i = 0;
-    bark_i = K; //in case we go out of sync reset this too
+    struct key_event *e = &key_events[key_events_head++ % KEY_EVENTS];
+    e->t_us = t_us;
+    e->rabi = i;
+    e->down = down;
 }
 
-void statemachine(int bit)
+// Flip read and write buffer
+// t_now_us is the time the cry of n rabies completed.
+void flip(uint64_t t_now_us, int n)
 {
-    switch (state) {
-        case S_REST:
-            if (bit == GROWL) { //growl
-                state = S_ALERT;
-            }
-            break;
-        case S_ALERT:
-            state = bit?S_HOWL:S_BARK;
-            (*rabies)[rabi_i] = 0;
-            break;
-        case S_BARK:
-            (*rabies)[rabi_i] << 1;
-            (*rabies)[rabi_i] |= bit;
-
-            if (!--bark_i) {
-                state = S_ALERT;
-                bark_i = K;
-                rabi_i++;
+    uint32_t first = key_events_head;
+
+    if (key_states_read == key_states_a) {
+        key_states_read  = key_states_b;
+        key_states_write = key_states_a;
+    } else {
+        key_states_read  = key_states_a;
+        key_states_write = key_states_b;
+    }
+    //Against the last cry, or with STREAM what the events told already
+    const uint8_t *before = key_states_write;
+#if STREAM
+    before = key_told;
+#endif
+    //A word at a time, most cries nothing changed. Bytes in the word are
+    //in memory order, both the RP2040 and the hosts are little endian.
+    for (int w = 0; w < W_WORDS; w++) {
+        uint32_t a, b;
+        memcpy(&a, &key_states_read[w * 4], 4);
+        memcpy(&b, &before[w * 4], 4);
+        for (uint32_t d = WORD_LEVELS(a ^ b); d; d &= d - 1) {
+            int i = w * 4 + __builtin_ctz(d) / 8;
+            bool down = KEY_LEVEL(key_states_read[i]);
+            //Gone from the pack, its key goes up now
+            if (i >= n) {
+                key_event(i, down, t_now_us);
+                continue;
             }
-            break;
-        case S_HOWL: //stay put so main can check state
-            break;
+            //The frame of rabi i was followed by the frames of the rabies
+            //after it and the howl. Subtract that and the age it reported.
+            uint32_t bits_after = cry_bits - frame_end[i];
+            key_edge_us[i] = t_now_us - bits_after * T_BIT_US - KEY_AGE_US(key_states_read[i]);
+            if (!t_unreported_edge || key_edge_us[i] < t_unreported_edge)
+                t_unreported_edge = key_edge_us[i];
+            key_event(i, down, key_edge_us[i]);
+        }
+    }
+#if STREAM
+    memcpy(key_told, key_states_read, sizeof(key_told));
+    memcpy(frame_end_good, frame_end, n * sizeof(frame_end[0]));
+    memcpy(frame_us_good, frame_us, n * sizeof(frame_us[0]));
+#endif
+    memset(key_states_write, 0, W);
+
+    //The events of this cry in the order the keys changed. Usually one or two
+    if (key_events_head - first > KEY_EVENTS)
+        first = key_events_head - KEY_EVENTS;
+    for (uint32_t j = first; j != key_events_head; j++) {
+        struct key_event e = key_events[j % KEY_EVENTS];
+        uint32_t p = j;
+        for (; p != first && key_events[(p - 1) % KEY_EVENTS].t_us > e.t_us; p--)
+            key_events[p % KEY_EVENTS] = key_events[(p - 1) % KEY_EVENTS];
+        key_events[p % KEY_EVENTS] = e;
+    }
+}
+
+int key_event_next(uint32_t *tail, struct key_event *e)
+{
+    if (*tail == key_events_head)
+        return 0;
+    if (key_events_head - *tail > KEY_EVENTS) {
+        *tail = key_events_head;
+        return -1;
     }
+    *e = key_events[(*tail)++ % KEY_EVENTS];
+    return 1;
 }
 
-void interrupt_rising()
+#if STREAM
+//The frame of rabi i is in, its age counts from now
+static void stream_frame(int i)
 {
-    sleep_ns((T0H+T1H)/2);
-    bit = read(input);
-    statemachine(bit);
+    uint8_t s = key_states_write[i];
+    int32_t late = frame_us[i] - frame_us_good[i];
+
+    if (cry_bad || frame_end[i] != frame_end_good[i] ||
+            late <= -T_BIT_US / 2 || late >= T_BIT_US / 2)
+        return;
+
+    if (!KEY_LEVEL(s ^ key_told[i]))
+        return;
+    key_told[i] = s;
+    key_edge_us[i] = t_rx_us - KEY_AGE_US(s);
+    if (!t_unreported_edge || key_edge_us[i] < t_unreported_edge)
+        t_unreported_edge = key_edge_us[i];
+    key_event(i, KEY_LEVEL(s), key_edge_us[i]);
+}
+#endif
+
+//Feed it the bits of a cry, see canine.h
+//return:
+//-1 error, reset me!
+// 0 still busy, expecting more data. Feed me!
+// 1 done. Seen n rabies
+int statemachine(bool bit, bool reset, int *n_rabies)
+{
+    static unsigned wolf_id, frame;
+    static uint8_t state = CA_GROWL;
+
+    /*
+      " Everyone knows that debugging is twice as hard as writing
+        a program in the first place. So if you're as clever as
+        you can be when you write it, how will you ever debug it? "
+                                               -- Brian Kernighan
+    */
+
+    if (reset) {
+        state = CA_GROWL;
+        return 0;
+    }
+
+    struct canine_step step = canine_akela[state][bit];
+    state = step.next;
+    frame = (frame << 1) | bit;
+    cry_bits++;
+
+    switch (step.action) {
+        case CA_ERROR:              //something wrong. we should reset.
+            return -1;
+        case CA_START:
+            wolf_id = 0;
+            cry_bits = 1;
+            akela_stats.cry_frames = 0;
+#if STREAM
+            cry_bad = false;
+            t_first_bit = t_rx_us;
+#endif
+            return 0;
+        case CA_RABI:               //we expect to rcv K bits + parity from neighbor
+            frame = 0;
+            return 0;
+        case CA_SAME:
+            if (wolf_id < W) {
+                key_states_write[wolf_id] = key_states_read[wolf_id];
+                frame_end[wolf_id] = cry_bits;
+            }
+            wolf_id++;
+            return 0;
+        case CA_STORE:
+            akela_stats.cry_frames++;
+            if (wolf_id >= W) {
+                wolf_id++;
+                return 0; //more rabies than we have room for
+            }
+            frame_end[wolf_id] = cry_bits;
+#if STREAM
+            frame_us[wolf_id] = t_rx_us - t_first_bit;
+#endif
+            if (FRAME_OK(frame)) {
+                key_states_write[wolf_id] = frame >> 1;
+#if STREAM
+                stream_frame(wolf_id);
+#endif
+            } else {
+#if STREAM
+                cry_bad = true;
+#endif
+                //Glitch. Keep what we knew, the next cry will tell us
+                key_states_write[wolf_id] = key_states_read[wolf_id];
+                akela_stats.bad_frames++;
+                rabi_bad_frames[wolf_id]++;
+                //Unless the rabi thinks we know. A reset makes it tell again
+                if (DELTA)
+                    return -1;
+            }
+            wolf_id++;
+            return 0;
+        case CA_DONE:
+            *n_rabies = wolf_id;
+            return 1; //return number of rabies spotted
+    }
+    return 0;
 }
 
-void wakeup_pack()
+enum states {STATE_GOOD, STATE_COOLDOWN, STATE_RESET, STATE_IDLE};
+static int state;
+static int good_cnt;
+static int resets_sent;
+static int pack_size;           //rabies in the last cry, 0 after a reset
+static uint64_t t_watch_dog;
+static uint64_t t_lost_sync;    //0 if we are in sync
+static uint64_t t_cry_start;
+static unsigned scan_settled;   //cries in a row that fit a shorter period
+
+#define RESET_WATCHDOG(_tmo) t_watch_dog = t_now_us + (_tmo)
+#define T_PACK_TIMEOUT  (akela_tune.pack_timeout_us ? akela_tune.pack_timeout_us : PACK_TIMEOUT)
+#define T_WATCHDOG      (akela_tune.watchdog_us ? akela_tune.watchdog_us : WATCHDOG_TIMEOUT)
+
+static void growl(uint64_t t_us)
 {
-    bark_ful(GROWL);
-    bark_ful(HOWL);
+#if SCAN_US
+    akela_growl_at(t_us);
+#else
+    akela_write(1);
+    akela_write(1);
+#endif
 }
 
-void flip()
+void akela_stop(void)
 {
-    rabies = (rabies == &rabies_A)? &rabies_B : &rabies_A;
+#if SCAN_US
+    akela_growl_at(0);
+#endif
 }
 
-void report(packsize)
+#if SCAN_US
+/* With SCAN_US cries start on a grid of SCAN_US from the first one. The
+ * period is the multiple of it that fits the cry and what was done with it.
+ * An overrun skips to the next slot on the grid. */
+static uint64_t next_cry(uint64_t t_now_us)
 {
-    int *prev[W] = (rabies == &rabies_A)? &rabies_B : &rabies_A;
-    int *curr[W] = rabies;
+    uint32_t busy = t_now_us - t_cry_start;
+    uint32_t need = (busy + SCAN_US - 1) / SCAN_US * SCAN_US;
 
-    //No need to go to W, packsize is the actual size of the pack
-    for (int w = 0; w<packsize; w++) {
-        if ((*prev)[w] != (*curr)[w]) {
-            //event!
+    akela_stats.scan_busy_us = busy;
+    if (busy > akela_stats.scan_us) {
+        akela_stats.scan_overruns++;
+        akela_stats.scan_us = need;
+        scan_settled = 0;
+    } else if (need < akela_stats.scan_us) {
+        if (++scan_settled >= SCAN_SETTLE) {
+            akela_stats.scan_us -= SCAN_US;
+            scan_settled = 0;
         }
+    } else {
+        scan_settled = 0;
     }
+    return t_cry_start + akela_stats.scan_us;
 }
+#endif
 
-void main()
+// Lost sync. Reset everyone right away, the reset flushes the pack.
+#define GOTO_RESYNC() {\
+    akela_stats.resyncs++;\
+    if (!t_lost_sync) t_lost_sync = t_now_us;\
+    resets_sent = 0;\
+    GOTO_RESET();\
+}
+#define GOTO_RESET() {\
+    akela_stop();\
+    RESET_WATCHDOG(T_PACK_TIMEOUT);\
+    state = STATE_RESET;\
+    pack_size = 0;\
+    resets_sent++;\
+    akela_stats.resets++;\
+    akela_write(RESET_MSG);\
+    break;\
+}
+#define GOTO_COOLDOWN() {\
+    if (state != STATE_COOLDOWN) akela_stats.cooldowns++;\
+    RESET_WATCHDOG(T_WATCHDOG);\
+    state = STATE_COOLDOWN;\
+    break;\
+}
+#define GOTO_GOOD() GOTO_GOOD_AT(t_now_us)
+#define GOTO_GOOD_AT(_t) {\
+    uint64_t t_at = (_t);\
+    if (t_lost_sync) {\
+        akela_stats.recovery_last_us = t_now_us - t_lost_sync;\
+        if (akela_stats.recovery_last_us > akela_stats.recovery_max_us)\
+            akela_stats.recovery_max_us = akela_stats.recovery_last_us;\
+        t_lost_sync = 0;\
+    }\
+    t_watch_dog = t_at + T_PACK_TIMEOUT;\
+    t_cry_start = t_at;\
+    state = STATE_GOOD;\
+    (void)statemachine(0, true, NULL);\
+    akela_cry_start(t_at);\
+    growl(t_at);\
+    break;\
+}
+// With SCAN_US the next cry waits for its slot, after the caller is done
+// with this one
+#define GOTO_IDLE() {\
+    state = STATE_IDLE;\
+    break;\
+}
+
+void akela_init(void)
 {
-    //TODO set input to INPUT, attach interrupt rising edge
-
-    rabies = &rabies_A;
-
-    while (1) {
-        reset_statemachine();
-        wakeup_pack();
-        sleep_ms(1);
-        if (state == S_HOWL)
-            report(rabi_i)
-            flip()
-        else {
-            //help! out of sync?
-        }
-        sleep_ms(9);
+    state = STATE_COOLDOWN;
+    good_cnt = 0;
+    resets_sent = 0;
+    pack_size = 0;
+    t_watch_dog = 0;
+    t_lost_sync = 0;
+    akela_stats.scan_us = SCAN_US;
+    scan_settled = 0;
+    (void)statemachine(0, true, NULL);
+}
+
+void akela_step(uint64_t t_now_us)
+{
+    switch (state) {
+        // In the GOOD state we are happy.
+        // We initiated a new transmission
+        // and are now waiting for all data.
+        case STATE_GOOD:
+            if (t_now_us > t_watch_dog) {               //we expect data, but got silence. Do reset.
+                akela_stats.timeouts++;
+                GOTO_RESYNC();
+            }
+            if (!akela_data_ready()) break;             //still waiting for data
+
+            int data = akela_read();
+            if (data == RESET_MSG) GOTO_RESYNC();       //unsolicited reset, someone must have panicked
+            if (data == ERROR_MSG) GOTO_RESYNC();       //now I'm panicking!
+
+            int n;
+#if STREAM
+            uint32_t events = key_events_head;
+            t_rx_us = t_now_us;
+#endif
+            int r = statemachine(data, false, &n);      //feed it to our statemachine
+            if (r==-1) GOTO_RESYNC();                   //statemachine indicated it is confused.
+#if STREAM
+            if (!r && key_events_head != events)
+                akela_stream(t_now_us);                 //someone does not have to wait for the howl
+#endif
+            good_cnt++;
+            if (AKELA_LOG && good_cnt % 10000 == 0) {
+                printf("Happy for %d, bad frames %lu\n",
+                        good_cnt, (unsigned long)akela_stats.bad_frames);
+            }
+            if (!r) {
+                RESET_WATCHDOG(T_PACK_TIMEOUT);         //data received but not done yet, watchdog takes chillpill
+                break;
+            }
+            //We are done! we recvd a good cry. A misaligned rabi can
+            //still produce cries that look fine, but not of the right size.
+            if (pack_size && n != pack_size) GOTO_RESYNC();
+            pack_size = n;
+            akela_stats.cries++;
+            akela_stats.cry_last_us = t_now_us - t_cry_start;
+            flip(t_now_us, n);
+            akela_cry_done(t_now_us, n);
+            //Now we have done stuff do a sanity check and check we
+            //did not received any data in the mean time.
+            if (akela_data_ready()) {
+                GOTO_RESYNC();                          //shit, something is wrong
+            } else if (SCAN_US) {
+                GOTO_IDLE();                            //everybody agrees, on schedule
+            } else {
+                GOTO_GOOD();                            //everybody agrees!
+            }
+
+#if SCAN_US
+        // A cry every SCAN_US. The last one is done, and so is the caller
+        // with it: what that took counts against the period.
+        case STATE_IDLE:
+            if (akela_data_ready()) GOTO_RESYNC();      //nobody should be talking
+            GOTO_GOOD_AT(next_cry(t_now_us));
+#endif
+
+        // Resets keep getting lost. Lets wait until we see no more
+        // activity at all for at least WDT. Then we reset everyone
+        // so we are all on the same page.
+        case STATE_COOLDOWN:
+            if (AKELA_LOG && good_cnt > 0) {
+                printf("Good count is %d, bad frames %lu\n",
+                        good_cnt, (unsigned long)akela_stats.bad_frames);
+                good_cnt = 0;
+            }
+            if (t_now_us > t_watch_dog) {                //No yapping heard. Good. Do reset.
+                resets_sent = 0;
+                GOTO_RESET();
+            }
+            if (!akela_data_ready()) break;             //Everyone is still silent. Good
+            (void)akela_read();                         //Hush!
+            GOTO_COOLDOWN();                            //Someone ruined it, now we all need to wait again.
+
+        // We've send a RESET_MSG. Now listen for it to come back.
+        // Whatever was still underway in the pack arrives before it.
+        case STATE_RESET:
+            if (t_now_us > t_watch_dog) {                //RESET_MSG not received in time
+                akela_stats.timeouts++;
+                if (resets_sent >= RESYNC_TRIES)
+                    GOTO_COOLDOWN();                    //Some rabi keeps yapping, icebox for everyone!
+                GOTO_RESET();                           //send another
+            }
+            if (!akela_data_ready()) break;             //I guess we have to wait
+            if (akela_read() != RESET_MSG) break;       //Leftovers, flushed out by our reset
+            GOTO_GOOD();                                //All aboard!
     }
 }
@@ -0,0 +1,192 @@
+#ifndef AKELA_H
+#define AKELA_H
+/**
+ * Reverse Addressable Binary Input
+ * Master implementation: "Akela"
+ *
+ * The part of the Akela that does not touch hardware: decoding cries and
+ * keeping the pack in sync. Used by the firmware and by the host tests.
+ **/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Provided by the user of akela.c:
+ *  K           number of inputs per rabi
+ *  W           maximum number of rabies
+ *  T_BIT_US    duration of a bit on the wire
+ *  T_RESET_US  duration of a reset on the wire
+ *  T0H_US, T1H_US, T_RESET_H_US  high time of a 0, 1 and reset
+ *  AKELA_LOG   print status lines (0 or 1)
+ *  DELTA       delta polls (0 or 1), must match raddr/wolf.h. 0 if not defined
+ *  HALL        analog hall-effect keys (0 or 1), must match raddr/wolf.h. 0 if
+ *              not defined
+ *  SCAN_US     start a cry every SCAN_US, 0 (default) for as fast as the pack
+ *              goes. See akela_growl_at()
+ *  STREAM      key events as soon as a frame is in, not at the end of the cry
+ *              (0 or 1). 0 if not defined. See akela_stream() */
+#include "akela_config.h"
+#ifndef DELTA
+#define DELTA 0
+#endif
+#ifndef HALL
+#define HALL 0
+#endif
+#ifndef SCAN_US
+#define SCAN_US 0
+#endif
+#ifndef STREAM
+#define STREAM 0
+#endif
+
+/* A frame is the key level followed by K-1 bits age of its last edge.
+ * The age is in units of 2^AGE_SHIFT uS. Must match raddr/wolf.h
+ * With HALL the K-1 bits are the travel of the key, 0 at rest, all ones
+ * all the way down. There is no age then, an edge is as old as the cry. */
+#define AGE_SHIFT 5
+#define KEY_LEVEL(_s)   (((_s) >> (K - 1)) & 1)
+#define KEY_TRAVEL(_s)  ((_s) & ((1 << (K - 1)) - 1))
+#if HALL
+#define KEY_AGE_US(_s)  0
+#else
+#define KEY_AGE_US(_s)  ((uint32_t)KEY_TRAVEL(_s) << AGE_SHIFT)
+#endif
+
+/* Every frame ends with a parity bit. The number of ones in a good frame is
+ * odd. Must match raddr/wolf.h */
+#define FRAME_LEN (K + 1)
+#define FRAME_OK(_f)    __builtin_parity(_f)
+
+/* In front of a frame: the bark, with DELTA the bit that says one follows */
+#define MARK_LEN (1 + DELTA)
+
+/* Bits in a cry of a full pack: growl, W frames with their marker, howl */
+#define CRY_BITS (2 + W * (FRAME_LEN + MARK_LEN))
+
+/* Worst case for anything to travel the pack. Every rabi may still have a
+ * frame queued in front of it and forwarding a reset costs a reset. On top
+ * of that the leftovers of a full cry may still be on their way. */
+#define HOP_US          ((FRAME_LEN + MARK_LEN + 1) * T_BIT_US + T_RESET_US)
+#define PACK_TIMEOUT    (W * HOP_US + CRY_BITS * T_BIT_US)
+
+/* Resets we send without hearing the echo before taking the slow road */
+#define RESYNC_TRIES 3
+
+#define WATCHDOG_TIMEOUT (100 * 1000)  /* uS of silence we want in cooldown */
+
+/* A cry that overran SCAN_US stretches the period to the multiple of SCAN_US
+ * it needed. It shrinks again by one SCAN_US after this many cries in a row
+ * that would have fit. */
+#define SCAN_SETTLE     256
+
+/* What akela_read() returns besides a 0 or 1 */
+#define RESET_MSG        (-1)
+#define ERROR_MSG        (-2)
+
+/* Symbols are told apart by how long they are high. Anything above
+ * T_ONE_NS is a 1, above T_RESET_NS a reset. */
+#define T_ONE_NS        15200
+#define T_RESET_NS      32000
+
+/* Returns 0, 1 or RESET_MSG */
+static inline int timing_to_bit(uint32_t width_ns)
+{
+    if (width_ns > T_RESET_NS) return RESET_MSG;
+    if (width_ns > T_ONE_NS) return 1;
+    return 0;
+}
+
+/* Would a rabi accept this pulse? Same windows as its input capture. */
+static inline bool pulse_known(uint32_t width_ns)
+{
+    uint32_t t = width_ns;
+    return (t + 1000 >= T0H_US * 1000 && t <= (T0H_US + 4) * 1000) ||
+           (t + 1000 >= T1H_US * 1000 && t <= (T1H_US + 4) * 1000) ||
+           (t + 3000 >= T_RESET_H_US * 1000 && t <= (T_RESET_H_US + 3) * 1000);
+}
+
+/* To be implemented by the user of akela.c */
+extern bool akela_data_ready(void);
+extern int  akela_read(void);
+extern void akela_write(int bit);       /* 0, 1 or RESET_MSG */
+extern void akela_cry_start(uint64_t t_now_us);
+extern void akela_cry_done(uint64_t t_now_us, int n_rabies);
+/* Only with SCAN_US: write the growl, two 1s, at t_us. Right away if that
+ * is now or past, else from a timer, so the cry starts on time however busy
+ * the caller is. 0 cancels a growl that was not written yet. */
+extern void akela_growl_at(uint64_t t_us);
+#if STREAM
+/* A frame in the middle of a cry brought key events, the cry is not done
+ * yet. key_states_read is still the last cry, it flips when this one is.
+ * Only frames at the bit and the time the last good cry had them, and none
+ * after a bad frame, a bit slip does not get through. A cry cut short
+ * by a glitch keeps the events it had, the next one sets right what a rabi
+ * that lost its place got wrong. */
+extern void akela_stream(uint64_t t_now_us);
+#endif
+
+struct akela_stats {
+    uint32_t cries;             /* completed cries */
+    uint32_t bad_frames;        /* frames that failed the parity check */
+    uint32_t resyncs;           /* times we lost sync */
+    uint32_t resets;            /* resets sent */
+    uint32_t cooldowns;         /* times we took the slow road */
+    uint32_t timeouts;          /* watchdog expired waiting for data or a reset */
+    uint32_t cry_last_us;       /* from starting the last cry until its howl */
+    uint32_t cry_frames;        /* in the last cry. With DELTA the others did not change */
+    uint32_t recovery_last_us;  /* from losing sync until the next poll */
+    uint32_t recovery_max_us;
+    uint32_t scan_us;           /* the period with SCAN_US, stretched by overruns */
+    uint32_t scan_busy_us;      /* the last cry and its akela_cry_done(), of scan_us */
+    uint32_t scan_overruns;     /* cries that took longer than scan_us */
+};
+extern struct akela_stats akela_stats;
+
+/* Timeouts the firmware can change at run time, from its settings. 0, the
+ * default, for the define. */
+struct akela_tune {
+    uint32_t pack_timeout_us;   /* PACK_TIMEOUT */
+    uint32_t watchdog_us;       /* WATCHDOG_TIMEOUT */
+};
+extern struct akela_tune akela_tune;
+//Frames that failed the parity check, per rabi. Points at a bad link.
+extern uint32_t rabi_bad_frames[W];
+
+//Two buffers holding the key state. Once a full message is received
+//we flip the buffers so we do not get spurious key toggles while receiving
+//a message. Comparing the 2 gives the key events below.
+extern uint8_t *key_states_read;
+//Estimated time the key last changed. Used to order simultaneous events.
+extern uint64_t key_edge_us[W];
+//Oldest key event not yet reported to the host, 0 if none.
+extern uint64_t t_unreported_edge;
+
+/* Every key that went up or down, from flip(). The events of a cry are in
+ * the order of their key_edge_us. A rabi that left the pack goes up at the
+ * end of the cry. A ring: every consumer keeps its own tail, starting at
+ * key_events_head, and is on its own if it falls KEY_EVENTS behind. */
+#ifndef KEY_EVENTS
+#define KEY_EVENTS 64           /* a power of 2 */
+#endif
+struct key_event {
+    uint64_t t_us;
+    uint16_t rabi;
+    bool down;
+};
+extern struct key_event key_events[KEY_EVENTS];
+extern uint32_t key_events_head;    /* events so far */
+
+void flip(uint64_t t_now_us, int n);
+/* The event at *tail and moves it on. 0 if there is none yet, -1 if it fell
+ * behind: the events so far are skipped, key_states_read has the keys. */
+int key_event_next(uint32_t *tail, struct key_event *e);
+int statemachine(bool bit, bool reset, int *n_rabies);
+
+void akela_init(void);
+/* Run the Akela for a bit. Call this as often as you can */
+void akela_step(uint64_t t_now_us);
+/* Before someone else takes the line, drops a growl still to come.
+ * akela_init() takes the line back */
+void akela_stop(void);
+
+#endif
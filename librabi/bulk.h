@@ -0,0 +1,160 @@
+#ifndef BULK_H
+#define BULK_H
+/**
+ * Reverse Addressable Binary Input
+ * Extended messages, see doc/protocol2.md. Only the bulk ones we use.
+ *
+ * A cry starting with a 0 instead of a growl is an extended message:
+ *
+ *   0 IOB op(4) data EOT                  method or call, everyone copies it
+ *   0 IOB op(4) data [0 answer].. EOT     query, the last one adds its answer
+ *
+ * bulk_step() follows one through a rabi, the same way for every rabi. The
+ * pack only copies them, what to do with one is up to the user of this.
+ **/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The header bits, has data (I), expects an answer (O), bulk (B) */
+#define EXT_I 4
+#define EXT_O 2
+#define EXT_B 1
+#define BULK_HDR(_iob, _op)     ((_iob) << 4 | (_op))
+#define BULK_HDR_BITS 7
+
+/* Firmware update of the pack */
+#define BULK_UPDATE     BULK_HDR(EXT_B, 1)          //go to the bootloader
+#define BULK_PAGE       BULK_HDR(EXT_I | EXT_B, 2)  //page(8), data, crc16 of page and data
+#define BULK_VERIFY     BULK_HDR(EXT_O | EXT_B, 3)  //answer: flags(8), pages(8), crc16 of them
+#define BULK_RUN        BULK_HDR(EXT_I | EXT_B, 4)  //pages(8), crc16: start the application
+
+#define BULK_APP        1   //flag in the answer to BULK_VERIFY: running the application
+
+/* Who is where in the pack */
+#define BULK_UID        BULK_HDR(EXT_I | EXT_O | EXT_B, 5)  //word(8), answer: that word of the UID
+
+#define UID_WORDS       4   //the 16 bytes of the unique ID of the MCU
+#define UID_HASH        4   //the word that is uid_hash() of the others
+
+#define BULK_PAGE_SIZE  128
+#define BULK_DATA_MAX   (1 + BULK_PAGE_SIZE + 2)
+
+static inline unsigned bulk_data_bits(unsigned hdr)
+{
+    switch (hdr) {
+        case BULK_PAGE: return 8 * (1 + BULK_PAGE_SIZE + 2);
+        case BULK_RUN:  return 8 * 3;
+        case BULK_UID:  return 8;
+        default:        return 0;
+    }
+}
+
+static inline unsigned bulk_answer_bits(unsigned hdr)
+{
+    return hdr == BULK_VERIFY || hdr == BULK_UID ? 32 : 0;
+}
+
+static inline bool bulk_known(unsigned hdr)
+{
+    return hdr == BULK_UPDATE || hdr == BULK_PAGE ||
+           hdr == BULK_VERIFY || hdr == BULK_RUN || hdr == BULK_UID;
+}
+
+/* FNV-1a, the rabi and the Akela have to agree on it */
+static inline uint32_t uid_hash(const uint32_t uid[UID_WORDS])
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < UID_WORDS; i++)
+        for (int b = 0; b < 32; b += 8)
+            h = (h ^ ((uid[i] >> b) & 0xFF)) * 16777619u;
+    return h;
+}
+
+/* CRC-16/CCITT-FALSE. A nibble at a time: the bootloader checks the whole
+ * application before it runs it, bit by bit that took ~40ms at 24MHz */
+#define CRC16_INIT 0xFFFF
+static inline uint16_t crc16(uint16_t crc, const uint8_t *p, unsigned n)
+{
+    static const uint16_t nibble[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+
+    while (n--) {
+        crc = crc << 4 ^ nibble[(crc >> 12) ^ (*p >> 4)];
+        crc = crc << 4 ^ nibble[(crc >> 12) ^ (*p++ & 0xF)];
+    }
+    return crc;
+}
+
+enum bulk_state {BS_TYPE, BS_HDR, BS_DATA, BS_TAIL, BS_ANSWER};
+
+struct bulk {
+    uint8_t state;
+    uint8_t hdr;
+    bool ok;                    //a message we know, complete
+    uint16_t left;              //bits to go in this state
+    uint16_t n;                 //data bits received
+    uint8_t data[BULK_DATA_MAX];
+};
+
+enum bulk_result {
+    BULK_COPY,                  //pass the bit on, more to come
+    BULK_END,                   //pass the bit on, that was the EOT
+    BULK_ANSWER,                //the EOT of a query: add our answer, then the EOT
+};
+
+static inline void bulk_reset(struct bulk *b)
+{
+    b->state = BS_TYPE;
+}
+
+/* Feed the bits of a message, starting with the type 0 */
+static inline int bulk_step(struct bulk *b, int bit)
+{
+    switch (b->state) {
+        case BS_TYPE:
+            b->hdr = 0;
+            b->n = 0;
+            b->ok = false;
+            b->left = BULK_HDR_BITS;
+            b->state = BS_HDR;
+            return BULK_COPY;
+        case BS_HDR:
+            b->hdr = (b->hdr << 1) | bit;
+            if (--b->left)
+                return BULK_COPY;
+            b->left = bulk_data_bits(b->hdr);
+            b->state = b->left ? BS_DATA : BS_TAIL;
+            return BULK_COPY;
+        case BS_DATA:
+            if (!(b->n & 7))
+                b->data[b->n >> 3] = 0;
+            b->data[b->n >> 3] |= bit << (7 - (b->n & 7));
+            b->n++;
+            if (!--b->left)
+                b->state = BS_TAIL;
+            return BULK_COPY;
+        case BS_TAIL:
+            b->state = BS_TYPE;
+            if (bit) {
+                b->ok = bulk_known(b->hdr);
+                return b->ok && bulk_answer_bits(b->hdr) ? BULK_ANSWER : BULK_END;
+            }
+            //The answer of someone before us
+            b->left = bulk_answer_bits(b->hdr);
+            if (!b->left)
+                return BULK_END;        //there should be none, broken
+            b->state = BS_ANSWER;
+            return BULK_COPY;
+        case BS_ANSWER:
+            if (!--b->left)
+                b->state = BS_TAIL;
+            return BULK_COPY;
+    }
+    b->state = BS_TYPE;
+    return BULK_END;
+}
+
+#endif
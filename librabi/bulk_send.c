@@ -0,0 +1,134 @@
+/**
+ * Reverse Addressable Binary Input
+ * One bulk message from the Akela. See bulk_send.h
+ **/
+
+#include <string.h>
+#include "bulk_send.h"
+
+struct bulk_reply bulk_reply;
+
+static enum {M_RESET, M_SYNC, M_SEND, M_ECHO, M_WAIT, M_DONE} mstate = M_DONE;
+static uint8_t hdr;
+static uint8_t data[BULK_DATA_MAX];
+static unsigned data_bits, total_bits;
+static unsigned sent, echoed;
+static unsigned resets;
+static uint32_t wait_us;
+static uint64_t t_next, t_timeout;
+
+static uint32_t answer;
+static unsigned answer_bits;            //still to come of the current one
+
+static int msg_bit(unsigned i)
+{
+    if (i == 0)
+        return 0;
+    if (i <= BULK_HDR_BITS)
+        return (hdr >> (BULK_HDR_BITS - i)) & 1;
+    i -= 1 + BULK_HDR_BITS;
+    if (i < data_bits)
+        return (data[i >> 3] >> (7 - (i & 7))) & 1;
+    return 1;
+}
+
+/* What came back: our message, with the answers in front of the EOT */
+static void echo(int bit)
+{
+    if (mstate == M_WAIT || echoed == total_bits)
+        return;     //nothing should, after the EOT
+    if (bit != 0 && bit != 1) {
+        bulk_reply.bad = true;
+        return;
+    }
+    if (answer_bits) {
+        answer = (answer << 1) | bit;
+        if (!--answer_bits) {
+            if (bulk_reply.n < W)
+                bulk_reply.answer[bulk_reply.n++] = answer;
+            else
+                bulk_reply.bad = true;
+        }
+        return;
+    }
+    if (echoed == total_bits - 1 && !bit && bulk_answer_bits(hdr)) {
+        answer = 0;
+        answer_bits = bulk_answer_bits(hdr);
+        return;
+    }
+    if (bit != msg_bit(echoed))
+        bulk_reply.bad = true;
+    echoed++;
+}
+
+void bulk_send(uint8_t h, const uint8_t *d, unsigned n, uint32_t wait)
+{
+    hdr = h;
+    memcpy(data, d, n);
+    data_bits = 8 * n;
+    total_bits = 1 + BULK_HDR_BITS + data_bits + 1;
+    sent = echoed = 0;
+    resets = 0;
+    answer_bits = 0;
+    wait_us = wait;
+    bulk_reply.bad = false;
+    bulk_reply.n = 0;
+    mstate = M_RESET;
+}
+
+bool bulk_send_step(uint64_t t_now_us)
+{
+    switch (mstate) {
+        case M_RESET:
+            akela_write(RESET_MSG);
+            t_timeout = t_now_us + PACK_TIMEOUT;
+            mstate = M_SYNC;
+            break;
+        case M_SYNC:
+            //Whatever was on its way before our reset
+            while (akela_data_ready()) {
+                if (akela_read() == RESET_MSG) {
+                    mstate = M_SEND;
+                    t_next = t_now_us;
+                    t_timeout = t_now_us + BULK_ECHO_US(total_bits);
+                    return false;
+                }
+            }
+            if (t_now_us > t_timeout) {
+                if (++resets < RESYNC_TRIES) {
+                    mstate = M_RESET;
+                } else {
+                    bulk_reply.bad = true;
+                    mstate = M_WAIT;
+                    t_next = t_now_us;
+                }
+            }
+            break;
+        case M_SEND:
+        case M_ECHO:
+            while (akela_data_ready())
+                echo(akela_read());
+            //One bit per T_BIT_US, the PIO has only a short FIFO
+            while (sent < total_bits && t_now_us >= t_next) {
+                akela_write(msg_bit(sent++));
+                t_next += T_BIT_US;
+            }
+            if (sent == total_bits)
+                mstate = M_ECHO;
+            if (echoed == total_bits || t_now_us > t_timeout) {
+                bulk_reply.bad |= echoed != total_bits;
+                mstate = M_WAIT;
+                t_next = t_now_us + wait_us;
+            }
+            break;
+        case M_WAIT:
+            while (akela_data_ready())
+                echo(akela_read());
+            if (t_now_us >= t_next)
+                mstate = M_DONE;
+            break;
+        case M_DONE:
+            return true;
+    }
+    return false;
+}
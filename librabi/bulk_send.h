@@ -0,0 +1,36 @@
+#ifndef BULK_SEND_H
+#define BULK_SEND_H
+/**
+ * Reverse Addressable Binary Input
+ * One bulk message from the Akela, see bulk.h
+ *
+ * Every message goes behind a reset, whatever the line was up to. Then the
+ * bits, paced, and we check they come back the same with the answers of a
+ * query in front of the EOT. The Akela does not poll meanwhile.
+ *
+ * Uses the hooks and configuration of akela.h.
+ **/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "akela.h"
+#include "bulk.h"
+
+/* Every bit the Akela sends, the rest of the pack answering a query */
+#define BULK_ECHO_US(_bits) \
+    (((_bits) + W * (1 + 32)) * T_BIT_US + PACK_TIMEOUT)
+
+/* What came back of the last one */
+struct bulk_reply {
+    bool bad;                   /* not our message, or not at all */
+    int n;                      /* answers */
+    uint32_t answer[W];         /* in the order of the pack */
+};
+extern struct bulk_reply bulk_reply;
+
+/* The n bytes of data, then give the pack wait_us after the EOT */
+void bulk_send(uint8_t hdr, const uint8_t *data, unsigned n, uint32_t wait_us);
+/* Returns true once the message and the wait are over */
+bool bulk_send_step(uint64_t t_now_us);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef CANINE_H
+#define CANINE_H
+/**
+ * Reverse Addressable Binary Input
+ * The CANINE protocol as transition tables, for the rabi and the Akela.
+ *
+ * Both sides look up [state][bit] for every bit they receive, move to the
+ * next state and do the action. The frame is unrolled into FRAME_LEN
+ * states, so there is no counter to keep: every bit costs one lookup,
+ * whatever the state. The tables are built by the preprocessor for the K
+ * of the includer, which also defines GROWL 1, HOWL 1 and BARK 0.
+ *
+ * With DELTA a rabi puts a bit in front of its frame: 1 and the frame
+ * follows, 0 and that is it, nothing changed since it last sent one. The
+ * includer defines DELTA the same on both sides, or not at all.
+ *
+ * A 0 where a rabi expects a growl starts an extended message, see bulk.h.
+ * The rabi follows that one with bulk_step() until it is over.
+ *
+ * Used by raddr/pack.c, librabi/akela.c and librabi/pack.c. Checked by
+ * librabi/test/fuzz_pack.c and fuzz_akela.c.
+ **/
+
+#include <stdint.h>
+
+#ifndef FRAME_LEN
+#define FRAME_LEN (K + 1)
+#endif
+//The Akela keeps a frame in a byte
+_Static_assert(FRAME_LEN <= 9, "K is at most 8");
+#ifndef DELTA
+#define DELTA 0
+#endif
+
+struct canine_step {
+    uint8_t next;
+    uint8_t action;
+};
+
+/* _m(0) up to _m(8), the longest frame. Rows past the frame fold onto the
+ * ones before it, overriding them with the same thing. */
+#define CANINE_REP4(_m, _i)     _m(_i) _m(_i + 1) _m(_i + 2) _m(_i + 3)
+#define CANINE_REPEAT(_m)       CANINE_REP4(_m, 0) CANINE_REP4(_m, 4) _m(8)
+#define CANINE_FOLD(_i)         ((_i) % FRAME_LEN)
+#define CANINE_LAST(_i)         (CANINE_FOLD(_i) == FRAME_LEN - 1)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+
+/* The rabi. Copies every frame it hears, after the howl it adds its own */
+enum canine_rabi_state {
+    CR_REST,        //wait for a growl
+    CR_ALERT,       //a bark, the frame of someone else follows. Or a howl
+    CR_EXT,         //in an extended message
+    CR_DELTA,       //a bark with DELTA, a frame follows on 1
+    CR_FRAME,       //copying bit 0 of that frame, CR_FRAME + 1 bit 1, ..
+};
+#define CR_STATES (CR_FRAME + FRAME_LEN)
+
+enum canine_rabi_action {
+    CR_QUIET,       //nothing to say
+    CR_COPY,        //pass the bit on
+    CR_HOWL,        //BARK, our frame and parity, HOWL. Then rest
+    CR_BULK,        //to bulk_step(), rest when it is over
+};
+
+#define CR_FRAME_ROW(_i) [CR_FRAME + CANINE_FOLD(_i)] = {\
+    {CANINE_LAST(_i) ? CR_ALERT : CR_FRAME + CANINE_FOLD(_i) + 1, CR_COPY},\
+    {CANINE_LAST(_i) ? CR_ALERT : CR_FRAME + CANINE_FOLD(_i) + 1, CR_COPY}},
+
+static const struct canine_step canine_rabi[CR_STATES][2] = {
+    [CR_REST]  = {{CR_EXT, CR_BULK}, {CR_ALERT, CR_COPY}},
+    [CR_ALERT] = {{DELTA ? CR_DELTA : CR_FRAME, CR_COPY}, {CR_REST, CR_HOWL}},
+    [CR_EXT]   = {{CR_EXT, CR_BULK}, {CR_EXT, CR_BULK}},
+    [CR_DELTA] = {{CR_ALERT, CR_COPY}, {CR_FRAME, CR_COPY}},
+    CANINE_REPEAT(CR_FRAME_ROW)
+};
+
+/* The Akela. Hears the growl back, then a frame per rabi, then the howl */
+enum canine_akela_state {
+    CA_GROWL,       //wait for our growl to come back
+    CA_MARKER,      //a bark, the frame of the next rabi follows. Or the howl
+    CA_DELTA,       //a bark with DELTA, a frame follows on 1
+    CA_FRAME,       //bit 0 of that frame, CA_FRAME + 1 bit 1, ..
+};
+#define CA_STATES (CA_FRAME + FRAME_LEN)
+
+enum canine_akela_action {
+    CA_ERROR,       //that was no growl
+    CA_START,       //a new cry
+    CA_RABI,        //a new frame
+    CA_SAME,        //with DELTA, a rabi without a frame: nothing changed
+    CA_BIT,         //shift in a bit of the frame
+    CA_STORE,       //shift in the parity, the frame is complete
+    CA_DONE,        //the cry is complete
+};
+
+#define CA_FRAME_ROW(_i) [CA_FRAME + CANINE_FOLD(_i)] = {\
+    {CANINE_LAST(_i) ? CA_MARKER : CA_FRAME + CANINE_FOLD(_i) + 1, CANINE_LAST(_i) ? CA_STORE : CA_BIT},\
+    {CANINE_LAST(_i) ? CA_MARKER : CA_FRAME + CANINE_FOLD(_i) + 1, CANINE_LAST(_i) ? CA_STORE : CA_BIT}},
+
+static const struct canine_step canine_akela[CA_STATES][2] = {
+    [CA_GROWL]  = {{CA_GROWL, CA_ERROR}, {CA_MARKER, CA_START}},
+    [CA_MARKER] = {{DELTA ? CA_DELTA : CA_FRAME, CA_RABI}, {CA_GROWL, CA_DONE}},
+    [CA_DELTA]  = {{CA_MARKER, CA_SAME}, {CA_FRAME, CA_RABI}},
+    CANINE_REPEAT(CA_FRAME_ROW)
+};
+
+#pragma GCC diagnostic pop
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CANINE_MODEL_H
+#define CANINE_MODEL_H
+/**
+ * Reverse Addressable Binary Input
+ * How long a cry takes, on paper.
+ *
+ * The Akela starts a cry with a growl. Every rabi passes a symbol on as
+ * soon as it saw its falling edge, so the growl ripples through W+1 wires
+ * taking T1H + hop_us each. Behind it the symbols of the cry follow back to
+ * back: a 0 arrives earlier than a 1, but then waits for the output to be
+ * free. The Akela has the cry once the howl, the last of them, fell. After
+ * thinking about it for akela_us it starts the next one.
+ *
+ * With delta polls a rabi sends only bark and a 0 when nothing changed, a
+ * bark, a 1 and its frame when it did.
+ *
+ * Used by tools/rabi_model and checked against librabi/test/pack_sim.c.
+ **/
+
+struct canine_model {
+    unsigned w;             /* rabies */
+    unsigned k;             /* bits per frame, without parity */
+    double t_bit_us;        /* TTOTAL */
+    double t1h_us;          /* high time of a 1 */
+    double hop_us;          /* from falling edge in until the rabi starts sending */
+    double akela_us;        /* from the howl until the Akela starts the next cry */
+    unsigned delta;         /* delta polls, 0 or 1 */
+    unsigned changed;       /* with delta polls, the rabies that send a frame */
+};
+
+/* What the first n rabies add to a cry. With delta polls the worst case,
+ * the ones that send a frame come first. */
+static inline unsigned canine_rabi_bits(const struct canine_model *m, unsigned n)
+{
+    if (!m->delta)
+        return n * (m->k + 2);
+    unsigned c = n < m->changed ? n : m->changed;
+    return c * (m->k + 3) + (n - c) * 2;
+}
+
+/* Symbols the Akela receives: growl, W times marker + frame + parity, howl */
+static inline unsigned canine_cry_bits(const struct canine_model *m)
+{
+    return 2 + canine_rabi_bits(m, m->w);
+}
+
+/* From starting a cry until starting the next one */
+static inline double canine_cry_us(const struct canine_model *m)
+{
+    return (m->w + 1) * (m->t1h_us + m->hop_us) +
+           (canine_cry_bits(m) - 1) * m->t_bit_us +
+           m->akela_us;
+}
+
+/* When rabi i samples its input, counted from the start of the cry. That is
+ * when the howl reaches it, behind the frames of the rabies before it. */
+static inline double canine_sample_us(const struct canine_model *m, unsigned i)
+{
+    return (i + 1) * (m->t1h_us + m->hop_us) + (1 + canine_rabi_bits(m, i)) * m->t_bit_us;
+}
+
+/* Worst case from a key edge until the Akela knows. The edge comes right
+ * after the first rabi sampled, so it is only reported by the next cry. */
+static inline double canine_latency_us(const struct canine_model *m)
+{
+    return canine_cry_us(m) + canine_cry_us(m) - m->akela_us - canine_sample_us(m, 0);
+}
+
+#endif
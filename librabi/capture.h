@@ -0,0 +1,58 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+/**
+ * Reverse Addressable Binary Input
+ * Raw pulse capture as streamed by the Akela on its second CDC interface.
+ *
+ * The stream is a sequence of little endian 16 bit words. A word below
+ * CAP_SATURATED is the width of a received pulse in counter ticks, as
+ * measured by howl_count. The rest are markers, some followed by more words:
+ *
+ *   CAP_SATURATED              pulse of CAP_SATURATED ticks or longer
+ *   CAP_DROPPED    n16         n pulses lost, the host did not keep up
+ *   CAP_TICK_HZ    hz32        ticks per second, first in every stream
+ *   CAP_RESET      t32         the Akela sent a reset at t uS
+ *   CAP_CRY        t32         the Akela started a cry at t uS
+ *
+ * 32 bit values are sent low word first. Timestamps wrap after ~71 minutes.
+ **/
+
+#include <stdint.h>
+
+#define CAP_SATURATED   0xFFFB
+#define CAP_DROPPED     0xFFFC
+#define CAP_TICK_HZ     0xFFFD
+#define CAP_RESET       0xFFFE
+#define CAP_CRY         0xFFFF
+
+/* Returned by cap_decode for a pulse */
+#define CAP_PULSE       1
+
+struct cap_decoder {
+    uint16_t marker;
+    int need, got;
+    uint32_t value;
+};
+
+/* Feed one word of the stream. Returns 0 while a marker is incomplete,
+ * else CAP_PULSE or the marker, with the width or the value in *value. */
+static inline int cap_decode(struct cap_decoder *d, uint16_t w, uint32_t *value)
+{
+    if (d->got < d->need) {
+        d->value |= (uint32_t)w << (16 * d->got++);
+        if (d->got < d->need) return 0;
+        *value = d->value;
+        return d->marker;
+    }
+    if (w <= CAP_SATURATED) {
+        *value = w;
+        return CAP_PULSE;
+    }
+    d->marker = w;
+    d->value = 0;
+    d->got = 0;
+    d->need = w == CAP_DROPPED ? 1 : 2;
+    return 0;
+}
+
+#endif
@@ -5,58 +5,41 @@
 
 #include <stdio.h>
 #include "wolf.h"
+#include "canine.h"
+#include "bulk.h"
 
 #define DBG 0
 
 void statemachine(int bit)
 {
-    static int state = S_REST;
-    static int bark_i = K;
+    static uint8_t state = CR_REST;
+    static struct bulk bulk;
 
-    switch (state) {
-        case S_REST:
-            if (bit == GROWL) { //growl
-                if (DBG) printf("received growl going in ALERT\n");
-                state = S_ALERT;
-                bark(GROWL); //wake up next with growl
-            } else {
-                if (DBG) printf("whut? staying in rest\n");
-                /* a BARK makes no sense here. Therefor just absorb it */
-            }
-            break; //Wait for next bit
-        case S_ALERT:
-            if (DBG) printf("in alert\n");
-            bark(BARK); //Yelp, so next will copy next frame
-            if (!bit) {
-                if (DBG) printf("going to BARK\n");
-                state = S_BARK; //
-                break; //Wait for next bit
-            }
+    struct canine_step step = canine_rabi[state][bit];
+    if (DBG) printf("%d -> %d\n", state, step.next);
+    state = step.next;
+
+    switch (step.action) {
+        case CR_COPY:
+            bark(bit); //Copy input to output
+            break;
+        case CR_HOWL:
             if (DBG) printf("howling my state\n");
+            bark_full(BARK); //Yelp, so next will copy our frame
+            int parity = 1;
             for (int k=0; k<K; k++) {
                 bark_full(SOME_INPUT[k]);
+                parity ^= SOME_INPUT[k];
             }
-            state = S_HOWL; // not really needed
-            /* FALL-THROUGH */
-        /* Since we do not have to wait for a bit we do a fall through here.
-         * It *is* an actual state in the finite automata sense. */
-        case S_HOWL:
-            //Maybe include parity bit?
-            bark_full(GROWL); //wake up next with growl
-            bark(HOWL); //Howl, so next will also go to S_HOWL
-            state = S_REST; //we are the last. Get some rest.
-            if (DBG) printf("going to REST\n");
-            break; //Wait for next bit
-        case S_BARK:
-            bark(bit); //Copy input to output
-            if (DBG) printf("BARK %d!\n", bark_i);
-            if (!--bark_i) {
-                state = S_ALERT;
-                if (DBG) printf("going to REST\n");
-                bark_i = K;
-                //maybe check parity? Go to S_REST on parity fail?
-            }
-            break; //Wait for next bit
+            bark_full(parity);
+            bark(HOWL); //Howl, so next will also howl
+            break;
+        case CR_BULK:
+            //Copied along, we know none of them
+            bark(bit);
+            if (bulk_step(&bulk, bit) != BULK_COPY)
+                state = CR_REST;
+            break;
     }
 }
 
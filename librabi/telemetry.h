@@ -0,0 +1,73 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+/**
+ * Reverse Addressable Binary Input
+ * Telemetry records as sent by the Akela over the CDC interface.
+ *
+ * Records are mixed with the normal console output, so every record starts
+ * with a sync word and ends with a checksum. All numbers are little endian.
+ *
+ *   sync   u16  TM_SYNC
+ *   type   u8   enum tm_record
+ *   seq    u8   incremented for every record
+ *   len    u16  bytes of payload
+ *   payload
+ *   sum    u16  fletcher16 over type up to the end of the payload
+ *
+ * TM_REC_COUNTERS payload: u32 t_ms, u32 counters[TM_N_COUNTERS]
+ * TM_REC_*_HIST payload:   u16 bin width, u16 bins, u32 counts[bins]
+ * The last bin of a histogram also counts everything beyond it.
+ * Everything counts since boot, the decoder takes the differences.
+ **/
+
+#include <stdint.h>
+
+#define TM_SYNC         0x5AA5
+#define TM_HEADER_LEN   6
+#define TM_MAX_PAYLOAD  512
+
+enum tm_record {
+    TM_REC_COUNTERS = 1,
+    TM_REC_CRY_HIST,        /* duration of a cry in uS */
+    TM_REC_PULSE_HIST,      /* width of received pulses in nS */
+    TM_REC_LATENCY_HIST,    /* end of a cry with a key change until the host has it, uS */
+};
+
+enum tm_counter {
+    TM_CRIES,
+    TM_RESETS,
+    TM_COOLDOWNS,
+    TM_TIMEOUTS,
+    TM_RESYNCS,
+    TM_BAD_FRAMES,
+    TM_RX_FIFO_FULL,        /* pulses may have been lost */
+    TM_TX_FIFO_FULL,        /* had to wait for the wire */
+    TM_UNKNOWN_PULSES,      /* pulses a rabi would not accept */
+    TM_RECOVERY_MAX_US,
+    TM_LATENCY_MAX_US,
+    TM_N_COUNTERS
+};
+
+#define TM_COUNTER_NAMES { \
+    "cries", "resets", "cooldowns", "timeouts", "resyncs", "bad frames", \
+    "rx fifo full", "tx fifo full", "unknown pulses", "recovery max us", \
+    "latency max us" }
+
+#define TM_CRY_BIN_US       100
+#define TM_CRY_BINS         64
+#define TM_PULSE_BIN_NS     1280
+#define TM_PULSE_BINS       64
+#define TM_LATENCY_BIN_US   250
+#define TM_LATENCY_BINS     64
+
+static inline uint16_t tm_fletcher16(const uint8_t *d, unsigned len)
+{
+    uint16_t a = 0, b = 0;
+    while (len--) {
+        a = (a + *d++) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+#endif
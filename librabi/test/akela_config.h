@@ -0,0 +1,20 @@
+#ifndef AKELA_CONFIG_H
+#define AKELA_CONFIG_H
+
+/* The pack as simulated by pack_sim.c, timings match the real thing */
+#ifndef K
+#define K 1
+#endif
+#ifndef W
+#define W 25
+#endif
+
+#define T_BIT_US    40
+#define T_RESET_US  96
+#define T0H_US      10
+#define T1H_US      25
+#define T_RESET_H_US 64
+
+#define AKELA_LOG 0
+
+#endif
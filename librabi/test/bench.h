@@ -0,0 +1,64 @@
+#ifndef BENCH_H
+#define BENCH_H
+/**
+ * Results of the benchmarks, one line each:
+ *
+ *   <benchmark> <metric> <value> <higher|lower> <tolerance in %>
+ *
+ * higher or lower is what is better. make bench compares them with
+ * bench_baseline.txt, which is the same, and fails on anything worse than
+ * its tolerance. make bench-baseline takes the results as the new baseline.
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* On the time of the host it varies, simulated time is the same every run */
+#define BENCH_HOST_TOL  50
+#define BENCH_SIM_TOL   5
+
+/* Long enough a run to measure, the best of a few */
+#define BENCH_RUN_S     0.2
+#define BENCH_RUNS      3
+
+static inline double bench_now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The name of the benchmark is that of the program */
+static inline const char *bench_name(const char *argv0)
+{
+    const char *s = strrchr(argv0, '/');
+    return s ? s + 1 : argv0;
+}
+
+static inline void bench_result(const char *bench, const char *metric, double value,
+        bool higher, int tolerance)
+{
+    printf("%s %s %.0f %s %d\n", bench, metric, value, higher ? "higher" : "lower", tolerance);
+}
+
+/* Runs of run(n) until BENCH_RUN_S passed, the best rate of BENCH_RUNS.
+ * run() does n rounds and returns the bits it decoded. */
+static inline double bench_bits_per_s(unsigned long (*run)(unsigned n))
+{
+    double best = 0;
+
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        unsigned long bits = 0;
+        double t_start = bench_now_s(), t;
+        do {
+            bits += run(1000);
+            t = bench_now_s() - t_start;
+        } while (t < BENCH_RUN_S);
+        if (bits / t > best)
+            best = bits / t;
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Decode throughput of the Akela: statemachine() and flip() of ../akela.c
+ *
+ * Cries of a full pack, like akela_step() gets them, in bits per second of
+ * the host. A key goes down and up now and then, the events are read back.
+ * Every cry has to come out as W rabies.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "../akela.h"
+#include "bench.h"
+
+/* As in wolf.h */
+#define GROWL 1
+#define HOWL 1
+#define BARK (!HOWL)
+
+/* Only akela_step() uses these */
+bool akela_data_ready(void) { return false; }
+int  akela_read(void) { abort(); }
+void akela_write(int bit) { }
+void akela_cry_start(uint64_t t_now_us) { }
+void akela_cry_done(uint64_t t_now_us, int n_rabies) { }
+
+/* Without and with the key of one rabi down */
+static uint8_t cries[2][CRY_BITS];
+
+static void make_cry(uint8_t *c, int down)
+{
+    unsigned n = 0;
+
+    c[n++] = GROWL;
+    for (int i = 0; i < W; i++) {
+        uint32_t frame = (uint32_t)(i == down) << (K - 1);
+        int parity = 1;
+        c[n++] = BARK;
+        if (DELTA)
+            c[n++] = 1;         //a frame follows
+        for (int k = K - 1; k >= 0; k--) {
+            c[n++] = (frame >> k) & 1;
+            parity ^= (frame >> k) & 1;
+        }
+        c[n++] = parity;
+    }
+    c[n++] = HOWL;
+    assert(n == CRY_BITS);
+}
+
+static uint64_t t_now = 1000 * 1000;
+static uint32_t events_tail;
+static unsigned events;
+
+static unsigned long run(unsigned n)
+{
+    for (unsigned j = 0; j < n; j++) {
+        //Down for 8 cries, up for 8
+        const uint8_t *c = cries[(j >> 3) & 1];
+        int r = 0, rabies = -1;
+
+        (void)statemachine(0, true, NULL);
+        for (unsigned b = 0; b < CRY_BITS; b++)
+            r = statemachine(c[b], false, &rabies);
+        assert(r == 1 && rabies == W);
+        t_now += CRY_BITS * T_BIT_US;
+        flip(t_now, rabies);
+
+        struct key_event e;
+        while (key_event_next(&events_tail, &e) == 1)
+            events++;
+    }
+    return (unsigned long)n * CRY_BITS;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = bench_name(argv[0]);
+
+    make_cry(cries[0], -1);
+    make_cry(cries[1], W / 2);
+    bench_result(name, "bits_per_s", bench_bits_per_s(run), true, BENCH_HOST_TOL);
+    assert(events > 0);
+    return 0;
+}
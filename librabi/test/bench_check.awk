@@ -0,0 +1,43 @@
+# Compares the results of the benchmarks with the baseline, see bench.h:
+#   awk -f bench_check.awk bench_baseline.txt bench_results.txt
+# Fails if a result is worse than the baseline by more than its tolerance,
+# or if it is missing. New ones are only shown.
+
+FILENAME == ARGV[1] {
+    k = $1 " " $2
+    base[k] = $3
+    better[k] = $4
+    tol[k] = $5
+    next
+}
+
+{
+    k = $1 " " $2
+    v = $3
+    seen[k] = 1
+    if (!(k in base)) {
+        printf "%-36s %12s %12s\n", k, v, "new"
+        next
+    }
+    b = base[k]
+    if (better[k] == "higher")
+        worse = v < b * (1 - tol[k] / 100)
+    else
+        worse = v > b * (1 + tol[k] / 100)
+    printf "%-36s %12s %12s %+7.1f%%%s\n", k, v, b, b ? (v - b) * 100 / b : 0,
+        worse ? "  worse" : ""
+    failed += worse
+}
+
+END {
+    for (k in base) {
+        if (!(k in seen)) {
+            printf "%-36s missing\n", k
+            failed++
+        }
+    }
+    if (failed) {
+        printf "%d benchmarks got worse than bench_baseline.txt\n", failed
+        exit 1
+    }
+}
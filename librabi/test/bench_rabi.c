@@ -0,0 +1,65 @@
+/**
+ * Decode throughput of a rabi: join_cry() of rabi-py32f0/raddr/pack.c
+ *
+ * The cries as a rabi halfway the pack gets them: the frames of those in
+ * front of it to copy, its own to add after the howl. Bits in per second of
+ * the host, the output goes nowhere.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "wolf.h"
+#include "pack.h"
+#include "bench.h"
+
+/* Rabies in front of us */
+#define AHEAD 12
+
+bool K_BINARY_INPUTS[K];
+void update_input(void) { }
+void bulk_message(const struct bulk *b) { }
+uint32_t bulk_answer(const struct bulk *b) { return 0; }
+
+static unsigned long out_bits;       //a bit ends low
+void raddr_output_schedule(bool bit, uint16_t tmo) { out_bits += !bit; }
+void raddr_output_bulk_begin(void) { }
+void raddr_output_bulk_schedule(bool bit, uint16_t tmo) { out_bits += !bit; }
+void raddr_output_bulk_end(void) { }
+
+static uint8_t cry[2 + AHEAD * (1 + FRAME_LEN)];
+
+static void make_cry(void)
+{
+    unsigned n = 0;
+
+    cry[n++] = GROWL;
+    for (int i = 0; i < AHEAD; i++) {
+        cry[n++] = BARK;
+        for (int k = 0; k < K; k++)
+            cry[n++] = 0;
+        cry[n++] = 1;           //parity
+    }
+    cry[n++] = HOWL;
+    assert(n == sizeof(cry));
+}
+
+static unsigned long run(unsigned n)
+{
+    for (unsigned j = 0; j < n; j++) {
+        K_BINARY_INPUTS[0] = (j >> 3) & 1;
+        for (unsigned b = 0; b < sizeof(cry); b++)
+            join_cry(cry[b], CRY_OKAY);
+    }
+    return (unsigned long)n * sizeof(cry);
+}
+
+int main(int argc, char **argv)
+{
+    make_cry();
+    join_cry(!GROWL, CRY_RESET);
+    bench_result(bench_name(argv[0]), "bits_per_s", bench_bits_per_s(run), true, BENCH_HOST_TOL);
+    //Every bit goes out, and a frame of our own
+    assert(out_bits > 0);
+    return 0;
+}
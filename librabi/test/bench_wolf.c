@@ -0,0 +1,58 @@
+/**
+ * Decode throughput of the reference rabi: statemachine() of ../pack.c
+ *
+ * The same cries as bench_rabi.c, with the K of ../wolf.h. Bits in per
+ * second of the host, the output goes nowhere.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "../wolf.h"
+#include "bench.h"
+
+#define AHEAD 12
+#define FRAME_LEN (K + 1)
+
+bool SOME_INPUT[K];
+static unsigned long highs;
+void gpio_set(int bit) { highs += bit; }
+void sleep_ns(int tmo) { }
+int gpio_get(void) { return 0; }
+
+extern void statemachine(int);
+
+static uint8_t cry[2 + AHEAD * (1 + FRAME_LEN)];
+
+static void make_cry(void)
+{
+    unsigned n = 0;
+
+    cry[n++] = GROWL;
+    for (int i = 0; i < AHEAD; i++) {
+        cry[n++] = BARK;
+        for (int k = 0; k < K; k++)
+            cry[n++] = 0;
+        cry[n++] = 1;           //parity
+    }
+    cry[n++] = HOWL;
+    assert(n == sizeof(cry));
+}
+
+static unsigned long run(unsigned n)
+{
+    for (unsigned j = 0; j < n; j++) {
+        SOME_INPUT[0] = (j >> 3) & 1;
+        for (unsigned b = 0; b < sizeof(cry); b++)
+            statemachine(cry[b]);
+    }
+    return (unsigned long)n * sizeof(cry);
+}
+
+int main(int argc, char **argv)
+{
+    make_cry();
+    bench_result(bench_name(argv[0]), "bits_per_s", bench_bits_per_s(run), true, BENCH_HOST_TOL);
+    assert(highs > 0);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Fuzz statemachine() of the Akela, ../akela.c
+ *
+ * Every input byte is a symbol from the pack: bit 0-1 is 0, 1, a reset of
+ * the statemachine or a 1 again. Completed cries are flipped in like
+ * akela_step() does. Checked:
+ *  - a reset always takes it back to waiting for a growl
+ *  - a cry of n rabies took exactly growl + n frames with marker + howl,
+ *    with DELTA a marker only for those that did not send a frame
+ *  - with DELTA a bad frame is an error, the rabi has to tell again
+ *  - key edges are never in the future
+ *  - the key events of a cry are in order and replayed give the key levels
+ * Writing beyond the key buffers is left to the sanitizers.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "../akela.h"
+
+#define SYM_RESET   2
+
+/* Only akela_step() uses these */
+bool akela_data_ready(void) { return false; }
+int  akela_read(void) { abort(); }
+void akela_write(int bit) { }
+void akela_cry_start(uint64_t t_now_us) { }
+void akela_cry_done(uint64_t t_now_us, int n_rabies) { }
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint64_t t_now = 1000 * 1000;
+    unsigned bits = 0;          //since the growl, 0 while waiting for one
+    uint32_t bad_frames = akela_stats.bad_frames;
+    uint32_t tail = key_events_head;
+    bool level[W];
+
+    (void)statemachine(0, true, NULL);
+    t_unreported_edge = 0;
+    for (int j = 0; j < W; j++)
+        level[j] = KEY_LEVEL(key_states_read[j]);
+
+    for (size_t i = 0; i < size; i++) {
+        int sym = data[i] & 3;
+
+        if (sym == SYM_RESET) {
+            (void)statemachine(0, true, NULL);
+            bits = 0;
+            continue;
+        }
+        int bit = sym & 1, n = -1;
+        t_now += T_BIT_US;
+        int r = statemachine(bit, false, &n);
+        if (!bits) {
+            //Only a growl is any good here
+            assert(r == (bit ? 0 : -1));
+            bits = bit;
+            continue;
+        }
+        bits++;
+        if (DELTA && r == -1) {
+            //Like akela_step(): resync
+            assert(akela_stats.bad_frames == ++bad_frames);
+            (void)statemachine(0, true, NULL);
+            bits = 0;
+            continue;
+        }
+        assert(r == 0 || r == 1);
+        if (!r)
+            continue;
+
+        unsigned frames = akela_stats.cry_frames;
+        assert(DELTA || frames == n);
+        assert(n >= 0 && frames <= n && bits == 2 + n * MARK_LEN + frames * FRAME_LEN);
+        flip(t_now, n);
+        struct key_event e;
+        uint64_t t_last = 0;
+        int r_ev;
+        while ((r_ev = key_event_next(&tail, &e)) == 1) {
+            assert(e.rabi < W && e.down != level[e.rabi]);
+            assert(e.t_us <= t_now && e.t_us >= t_last);
+            assert(e.rabi < n || e.t_us == t_now);
+            level[e.rabi] = e.down;
+            t_last = e.t_us;
+        }
+        if (r_ev == -1) {
+            assert(W > KEY_EVENTS);
+            for (int j = 0; j < W; j++)
+                level[j] = KEY_LEVEL(key_states_read[j]);
+        }
+        for (int j = 0; j < W; j++)
+            assert(level[j] == KEY_LEVEL(key_states_read[j]));
+        assert(t_unreported_edge <= t_now);
+        t_unreported_edge = 0;
+        bits = 0;
+    }
+    return 0;
+}
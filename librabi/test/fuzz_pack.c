@@ -0,0 +1,198 @@
+/**
+ * Fuzz join_cry() of the rabi, rabi-py32f0/raddr/pack.c
+ *
+ * Every input byte is a symbol from upstream: bit 0-1 is 0, 1, a reset or
+ * a 1 again, bit 2 the level of our own switch. The output is caught and
+ * compared, symbol by symbol, with the protocol as described in
+ * doc/protocol.md. That covers:
+ *  - a reset always takes the rabi back to REST
+ *  - everything the rabi receives during a cry is passed on, plus exactly
+ *    one frame of its own: output length is conserved
+ *  - the own frame has the switch level and odd parity
+ *  - extended messages are copied, with our answer to a query in front of
+ *    the EOT, and only complete ones we know are handed to bulk_message()
+ * Out of bounds accesses are left to the sanitizers.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include "wolf.h"
+#include "pack.h"
+
+#define SYM_RESET   2
+
+bool K_BINARY_INPUTS[K];
+void update_input(void) { }
+
+#define ANSWER 0xA5C30F96u
+static unsigned messages;           //bulk_message() calls for this symbol
+void bulk_message(const struct bulk *b)
+{
+    assert(b->ok && b->n == bulk_data_bits(b->hdr));
+    messages++;
+}
+uint32_t bulk_answer(const struct bulk *b) { return ANSWER ^ b->hdr; }
+
+/* What came out of the rabi for the current input symbol */
+static int out[2 * (FRAME_LEN + 2) + 34];
+static unsigned out_len;
+static int high = -1;               //bit of the high half, -1 when low is next
+
+static void output(bool level, uint16_t tmo)
+{
+    if (level) {
+        assert(high < 0);
+        assert(tmo == us_to_timer_tick(T0H) || tmo == us_to_timer_tick(T1H));
+        high = tmo == us_to_timer_tick(T1H);
+        return;
+    }
+    //Every bit takes TTOTAL, whatever it is
+    assert(high >= 0);
+    assert(tmo == us_to_timer_tick(high ? T1L : T0L));
+    assert(out_len < sizeof(out) / sizeof(out[0]));
+    out[out_len++] = high;
+    high = -1;
+}
+
+static bool in_bulk;
+void raddr_output_schedule(bool bit, uint16_t tmo) { assert(!in_bulk); output(bit, tmo); }
+void raddr_output_bulk_begin(void) { assert(!in_bulk); in_bulk = true; }
+void raddr_output_bulk_schedule(bool bit, uint16_t tmo) { assert(in_bulk); output(bit, tmo); }
+void raddr_output_bulk_end(void) { assert(in_bulk); in_bulk = false; }
+
+/* The protocol, the slow way, independent of canine.h */
+enum states {S_REST, S_ALERT, S_BARK, S_EXT};
+static enum states state;
+static unsigned bark_i;
+static unsigned ext_bits, ext_hdr, ext_answer;  //extended: bits so far, header, answer bits to go
+
+static bool ext_known(unsigned hdr)
+{
+    return hdr == BULK_UPDATE || hdr == BULK_PAGE || hdr == BULK_VERIFY || hdr == BULK_RUN || hdr == BULK_UID;
+}
+
+static unsigned ext_expect(int bit)
+{
+    unsigned n = 0;
+    unsigned data = 1 + BULK_HDR_BITS + bulk_data_bits(ext_hdr);
+
+    if (ext_bits < 1 + BULK_HDR_BITS) {
+        ext_hdr = ext_hdr << 1 | bit;
+        ext_bits++;
+        assert(!messages);
+        assert(out[n++] == bit);
+        return n;
+    }
+    if (ext_bits < data || ext_answer) {
+        ext_bits++;
+        ext_answer -= !!ext_answer;
+        assert(!messages);
+        assert(out[n++] == bit);
+        return n;
+    }
+    //Where the EOT goes
+    if (!bit && bulk_answer_bits(ext_hdr)) {
+        ext_answer = bulk_answer_bits(ext_hdr);
+        assert(out[n++] == 0);
+        assert(!messages);
+        return n;
+    }
+    state = S_REST;
+    if (bit && ext_known(ext_hdr) && bulk_answer_bits(ext_hdr)) {
+        uint32_t a = ANSWER ^ ext_hdr;
+        assert(out[n++] == 0);
+        for (int i = bulk_answer_bits(ext_hdr) - 1; i >= 0; i--)
+            assert(out[n++] == ((a >> i) & 1));
+    }
+    assert(out[n++] == bit);
+    assert(messages == (bit && ext_known(ext_hdr)));
+    return n;
+}
+
+/* Returns the number of symbols the rabi should send for bit */
+static unsigned expect(int bit, bool key)
+{
+    unsigned n = 0;
+
+    switch (state) {
+        case S_REST:
+            if (bit != GROWL) {
+                state = S_EXT;
+                ext_bits = 1;
+                ext_hdr = ext_answer = 0;
+                assert(out[n++] == bit);
+                return n;
+            }
+            assert(out[0] == GROWL);
+            state = S_ALERT;
+            return 1;
+        case S_ALERT:
+            assert(out[n++] == BARK);
+            if (bit != HOWL) {
+                state = S_BARK;
+                bark_i = FRAME_LEN;
+                return n;
+            }
+            //Our own frame
+            int ones = 0;
+            assert(out[n] == key);
+            for (int k = 0; k < FRAME_LEN; k++)
+                ones += out[n++];
+            assert(ones & 1);
+            assert(out[n++] == HOWL);
+            state = S_REST;
+            return n;
+        case S_BARK:
+            assert(out[n++] == bit);
+            if (!--bark_i)
+                state = S_ALERT;
+            return n;
+        case S_EXT:
+            return ext_expect(bit);
+        default:
+            abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    unsigned in = 0, sent = 0, howls = 0, answers = 0;
+
+    join_cry(!GROWL, CRY_RESET);
+    state = S_REST;
+
+    for (size_t i = 0; i < size; i++) {
+        int sym = data[i] & 3;
+        bool key = data[i] & 4;
+
+        K_BINARY_INPUTS[0] = key;
+        for (unsigned j = 0; j < sizeof(out) / sizeof(out[0]); j++)
+            out[j] = -1;
+        out_len = 0;
+        messages = 0;
+        if (sym == SYM_RESET) {
+            join_cry(!GROWL, CRY_RESET);
+            assert(!out_len);
+            state = S_REST;
+            continue;
+        }
+        int bit = sym & 1;
+        bool howl = state == S_ALERT && bit == HOWL;
+        bool ext = state == S_EXT || (state == S_REST && bit != GROWL);
+        join_cry(bit, CRY_OKAY);
+        assert(!in_bulk && high < 0);
+        assert(expect(bit, key) == out_len);
+        if (!ext)
+            assert(!messages);
+
+        in++;
+        sent += out_len;
+        howls += howl;
+        answers += out_len > 1 && state == S_REST && !howl;
+    }
+    //Nothing gets lost, and we only add our own frames and answers
+    assert(sent == in + howls * (FRAME_LEN + 1) + answers * (1 + 32));
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * Run a fuzz harness without libFuzzer, for gcc and make test.
+ *
+ *   fuzz_x [file|dir ...]          replay inputs, e.g. the corpus
+ *   fuzz_x -n runs [-s seed]       random inputs
+ *
+ * Given both, half of the random inputs are mutated replayed ones. Random
+ * inputs are written to fuzz_last_input before they are run, so
+ * after a failure that file holds the trace. For coverage guided fuzzing
+ * and minimizing a failing trace use the libFuzzer build, see Makefile.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define MAX_LEN 4096
+#define MAX_SEEDS 256
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static uint8_t buf[MAX_LEN];
+static unsigned runs;
+
+/* Replayed inputs, to mutate */
+static struct {
+    uint8_t *data;
+    size_t size;
+} seeds[MAX_SEEDS];
+static unsigned n_seeds;
+
+static void replay_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    if (n_seeds < MAX_SEEDS && (seeds[n_seeds].data = malloc(n + 1))) {
+        memcpy(seeds[n_seeds].data, buf, n);
+        seeds[n_seeds++].size = n;
+    }
+    LLVMFuzzerTestOneInput(buf, n);
+    runs++;
+}
+
+static void replay(const char *path)
+{
+    DIR *d = opendir(path);
+    if (!d) {
+        replay_file(path);
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        char p[1024];
+        snprintf(p, sizeof(p), "%s/%s", path, e->d_name);
+        replay(p);
+    }
+    closedir(d);
+}
+
+static uint32_t rnd_state = 0x12345678;
+static uint32_t rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+/* Mostly 0 and 1, like the wire. Now and then a reset */
+static size_t random_input(void)
+{
+    size_t size = rnd() % 512;
+    unsigned resets = rnd() % 64;
+    for (size_t i = 0; i < size; i++) {
+        uint32_t r = rnd();
+        buf[i] = r & 0xFF;
+        if ((buf[i] & 3) == 2 && (r >> 8) % 64 >= resets)
+            buf[i] ^= 1;
+    }
+    return size;
+}
+
+/* A seed with a few symbols changed, dropped or added */
+static size_t mutate_seed(void)
+{
+    unsigned s = rnd() % n_seeds;
+    size_t size = seeds[s].size;
+    memcpy(buf, seeds[s].data, size);
+    for (unsigned m = 1 + rnd() % 4; m--; ) {
+        size_t i = size ? rnd() % size : 0;
+        switch (rnd() % 3) {
+            case 0:
+                if (size) buf[i] = rnd();
+                break;
+            case 1:
+                if (!size) break;
+                memmove(&buf[i], &buf[i + 1], size - i - 1);
+                size--;
+                break;
+            case 2:
+                if (size == MAX_LEN) break;
+                memmove(&buf[i + 1], &buf[i], size - i);
+                buf[i] = rnd();
+                size++;
+                break;
+        }
+    }
+    return size;
+}
+
+static void random_runs(unsigned n)
+{
+    while (n--) {
+        size_t size = n_seeds && rnd() & 1 ? mutate_seed() : random_input();
+        FILE *f = fopen("fuzz_last_input", "wb");
+        if (f) {
+            fwrite(buf, 1, size, f);
+            fclose(f);
+        }
+        LLVMFuzzerTestOneInput(buf, size);
+        runs++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned n = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoul(optarg, NULL, 0); break;
+            case 's': rnd_state = strtoul(optarg, NULL, 0) | 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-n runs] [-s seed] [file|dir ...]\n", argv[0]);
+                return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++)
+        replay(argv[i]);
+    random_runs(n);
+    printf("%s: %u runs OK\n", argv[0], runs);
+    return 0;
+}
@@ -0,0 +1,785 @@
+/**
+ * Simulation of a pack of W rabies and the Akela from ../akela.c
+ *
+ * Time advances in steps of 1 uS. Every wire carries one symbol at a time,
+ * the receiver sees it at the falling edge. The rabies mirror join_cry()
+ * of the real pack. Every now and then a glitch is injected on a random
+ * wire and we check the Akela gets back in sync quickly.
+ *
+ * Then the pack gets a firmware update with ../update.c, over the same
+ * glitchy wires. The rabies mirror boot/main.c for that, with a flash of
+ * their own, and we check they all end up running the image.
+ *
+ * Last ../topology.c maps the pack, and again after some rabies were
+ * swapped and one replaced.
+ *
+ * Built with SCAN_US the cries have to keep to their slots, the growl is
+ * written at its time like a hardware alarm would.
+ *
+ * With -b it prints the scan rate, recovery and key latency for make bench,
+ * see bench.h. The key latency is from the edge at the rabi until the
+ * keyboard report of the firmware that has it, at most every HID_US. With
+ * STREAM the firmware has it before the cry is done, and bits slip on
+ * the way to the Akela while the keys are still: nothing may stream then.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../akela.h"
+#include "../canine_model.h"
+#include "../update.h"
+#include "../topology.h"
+#include "bench.h"
+
+/* As in wolf.h */
+#define GROWL 1
+#define HOWL 1
+#define BARK (!HOWL)
+enum states {S_REST, S_ALERT, S_HOWL, S_BARK, S_EXT, S_DELTA};
+
+#define SYM_RESET   RESET_MSG
+#define SYM_ERROR   ERROR_MSG
+
+#define T_HOP_US    3       /* From falling edge in until the rabi reacts */
+
+#define SIM_US          (4 * 1000 * 1000)
+#define QUIET_US        (200 * 1000)    /* no glitches and key changes at the end */
+#define GLITCH_US       (2 * PACK_TIMEOUT) /* average time between glitches */
+#define GLITCH_GAP_US   PACK_TIMEOUT    /* but at least this far apart */
+#ifndef KEY_US
+#define KEY_US          (5 * 1000)      /* average time between key changes */
+#endif
+#define HID_US          (10 * 1000)     /* between keyboard reports, as hid_task() */
+#define SLIP_US         (2 * 1000 * 1000) /* bit slips while the keys are still */
+
+#define QLEN 512
+
+/* The update */
+#define UPDATE_SIZE     (37 * BULK_PAGE_SIZE + 50)
+#define UPDATE_GLITCH_US (200 * 1000)   /* average time between glitches */
+#define UPDATE_MAX_US   (60 * 1000 * 1000)
+#define SIM_PAGES       64
+#define T_FLASH_US      6000            /* erase and program a page */
+#define T_START_US      20000           /* from reset until listening */
+
+/* wire i runs into rabi i, wire W runs back into the Akela */
+struct wire {
+    int q[QLEN];
+    unsigned head, tail;
+    int pending;            /* symbol on its way, or 0xFF */
+    uint64_t t_deliver;
+    uint64_t t_free;
+    int glitch;             /* applied to the next symbol */
+} wires[W + 1];
+
+enum glitches {G_NONE, G_FLIP, G_DROP, G_ERROR, G_RESET, G_INSERT, G_N};
+static const char *glitch_names[G_N] = {
+    "none", "bit flip", "dropped bit", "error pulse", "spurious reset", "inserted bit"
+};
+static unsigned glitch_cnt[G_N];
+
+enum info {INFO_ERASED, INFO_VALID, INFO_BUSY};
+enum pending {P_NONE, P_REBOOT, P_PAGE, P_RUN};
+
+struct rabi {
+    int state;
+    int bark_i;
+    bool key;
+    uint64_t t_edge;
+    struct bulk bulk;
+    /* As raddr/boot.h, the application or the bootloader */
+    bool boot;
+    uint8_t flash[SIM_PAGES][BULK_PAGE_SIZE];
+    enum info info;
+    unsigned info_pages;
+    uint16_t info_crc;
+    unsigned next_page;
+    uint16_t crc;
+    enum pending pending;
+    uint8_t pending_page;
+    uint8_t page_buf[BULK_PAGE_SIZE];
+    uint64_t t_deaf;        /* writing flash or starting */
+    uint32_t uid[UID_WORDS];
+    uint32_t reported;      /* with DELTA, the frame we sent last */
+    bool reported_valid;
+} rabies[W];
+
+static uint64_t t_now;
+static bool updating;
+static unsigned dropped;            /* queue full, while updating */
+static uint32_t rnd_state = 0x2545F491;
+
+static uint32_t rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static void send(int w, int sym)
+{
+    struct wire *wi = &wires[w];
+    if (wi->head - wi->tail >= QLEN) {
+        //Garbage after a reset in the middle of a page. A rabi drops it too
+        assert(updating);
+        dropped++;
+        return;
+    }
+    wi->q[wi->head++ % QLEN] = sym;
+}
+
+/* bulk_message() of raddr/main.c and boot/main.c */
+static void rabi_message(struct rabi *r)
+{
+    const uint8_t *d = r->bulk.data;
+    unsigned len = 1 + BULK_PAGE_SIZE;
+
+    switch (r->bulk.hdr) {
+        case BULK_UPDATE:
+            if (!r->boot)
+                r->pending = P_REBOOT;
+            break;
+        case BULK_PAGE:
+            if (!r->boot || crc16(CRC16_INIT, d, len) != (d[len] << 8 | d[len + 1]))
+                break;
+            if (d[0] >= SIM_PAGES || (d[0] != r->next_page && d[0] != 0))
+                break;
+            memcpy(r->page_buf, &d[1], BULK_PAGE_SIZE);
+            r->pending_page = d[0];
+            r->pending = P_PAGE;
+            break;
+        case BULK_RUN:
+            if (r->boot && r->next_page && d[0] == r->next_page && (d[1] << 8 | d[2]) == r->crc)
+                r->pending = P_RUN;
+            break;
+    }
+}
+
+/* bulk_answer() of raddr/main.c and boot/main.c */
+static uint32_t rabi_answer(struct rabi *r)
+{
+    if (r->bulk.hdr == BULK_UID) {
+        unsigned w = r->bulk.data[0];
+        return w < UID_WORDS ? r->uid[w] : w == UID_HASH ? uid_hash(r->uid) : 0;
+    }
+    if (r->boot)
+        return r->next_page << 16 | r->crc;
+    if (r->info != INFO_VALID)
+        return BULK_APP << 24 | CRC16_INIT;
+    return BULK_APP << 24 | r->info_pages << 16 | r->info_crc;
+}
+
+/* Its output is idle, do the slow stuff */
+static void rabi_pending(struct rabi *r)
+{
+    switch (r->pending) {
+        case P_REBOOT:
+            r->boot = true;
+            r->state = S_REST;
+            r->next_page = 0;
+            r->crc = CRC16_INIT;
+            if (r->info == INFO_VALID) {
+                r->next_page = r->info_pages;
+                r->crc = r->info_crc;
+            }
+            r->t_deaf = t_now + T_START_US;
+            break;
+        case P_PAGE:
+            r->t_deaf = t_now + T_FLASH_US;
+            if (!r->pending_page) {
+                r->next_page = 0;
+                r->crc = CRC16_INIT;
+                r->info = INFO_BUSY;
+                r->t_deaf += T_FLASH_US;
+            }
+            memcpy(r->flash[r->pending_page], r->page_buf, BULK_PAGE_SIZE);
+            r->crc = crc16(r->crc, r->page_buf, BULK_PAGE_SIZE);
+            r->next_page = r->pending_page + 1;
+            break;
+        case P_RUN:
+            r->info = INFO_VALID;
+            r->info_pages = r->next_page;
+            r->info_crc = r->crc;
+            r->boot = false;
+            r->state = S_REST;
+            r->t_deaf = t_now + T_FLASH_US + T_START_US;
+            break;
+        case P_NONE:
+            break;
+    }
+    r->pending = P_NONE;
+}
+
+static void rabi_rx(int i, int bit)
+{
+    struct rabi *r = &rabies[i];
+    int out = i + 1;
+
+    if (t_now < r->t_deaf)
+        return;
+
+    switch (bit) {
+        case 0 ... 1:
+            break;
+        case SYM_RESET:
+            r->state = S_REST;
+            r->bark_i = FRAME_LEN;
+            r->reported_valid = false;
+            bulk_reset(&r->bulk);
+            //raddr_output_flush(), whatever is queued is garbage anyway
+            wires[out].tail = wires[out].head;
+            send(out, SYM_RESET);
+            return;
+        default:
+            return; //unknown bit, ignored
+    }
+
+    switch (r->state) {
+        case S_REST:
+            if (bit == GROWL) {
+                r->state = S_ALERT;
+                send(out, GROWL);
+                break;
+            }
+            //An extended message
+            r->state = S_EXT;
+            bulk_reset(&r->bulk);
+            //fall through
+        case S_EXT:
+            switch (bulk_step(&r->bulk, bit)) {
+                case BULK_COPY:
+                    send(out, bit);
+                    return;
+                case BULK_END:
+                    send(out, bit);
+                    if (r->bulk.ok)
+                        rabi_message(r);
+                    break;
+                case BULK_ANSWER: {
+                    uint32_t a = rabi_answer(r);
+                    send(out, 0);
+                    for (int k = bulk_answer_bits(r->bulk.hdr) - 1; k >= 0; k--)
+                        send(out, (a >> k) & 1);
+                    send(out, 1);
+                    rabi_message(r);
+                    break;
+                }
+            }
+            r->state = S_REST;
+            break;
+        case S_ALERT:
+            if (bit != HOWL) {
+                send(out, BARK);
+                r->state = DELTA ? S_DELTA : S_BARK;
+                break;
+            }
+            //The key and the age of its last edge, like update_input()
+            uint32_t age = (t_now - r->t_edge) >> AGE_SHIFT;
+            if (age > (1u << (K - 1)) - 1)
+                age = (1u << (K - 1)) - 1;
+            uint32_t frame = (uint32_t)r->key << (K - 1) | age;
+            send(out, BARK);
+            r->state = S_REST;
+            if (DELTA) {
+                bool same = r->reported_valid && r->reported == frame;
+                r->reported = frame;
+                r->reported_valid = true;
+                send(out, !same);
+                if (same) {
+                    send(out, HOWL);
+                    break;
+                }
+            }
+            int parity = 1;
+            for (int k = K - 1; k >= 0; k--) {
+                send(out, (frame >> k) & 1);
+                parity ^= (frame >> k) & 1;
+            }
+            send(out, parity);
+            send(out, HOWL);
+            break;
+        case S_DELTA:
+            send(out, bit);
+            r->state = bit ? S_BARK : S_ALERT;
+            break;
+        case S_BARK:
+            send(out, bit);
+            if (!--r->bark_i) {
+                r->state = S_ALERT;
+                r->bark_i = FRAME_LEN;
+            }
+            break;
+    }
+}
+
+/* What the Akela hears */
+static int rx_q[QLEN];
+static unsigned rx_head, rx_tail;
+
+static void deliver(int w, int sym)
+{
+    switch (wires[w].glitch) {
+        case G_FLIP:
+            if (sym == 0 || sym == 1) sym ^= 1;
+            break;
+        case G_DROP:
+            sym = 0xFF;
+            break;
+    }
+    wires[w].glitch = G_NONE;
+    if (sym == 0xFF) return;
+
+    if (w < W) {
+        rabi_rx(w, sym);
+    } else {
+        assert(rx_head - rx_tail < QLEN);
+        rx_q[rx_head++ % QLEN] = sym;
+    }
+}
+
+static void glitch(void)
+{
+    int w = rnd() % (W + 1);
+    int g = 1 + rnd() % (G_N - 1);
+
+    glitch_cnt[g]++;
+    switch (g) {
+        case G_FLIP:
+        case G_DROP:
+            wires[w].glitch = g;
+            break;
+        case G_ERROR:
+            deliver(w, SYM_ERROR);
+            break;
+        case G_RESET:
+            deliver(w, SYM_RESET);
+            break;
+        case G_INSERT:
+            deliver(w, rnd() & 1);
+            break;
+    }
+}
+
+static void wire_step(int w)
+{
+    struct wire *wi = &wires[w];
+
+    if (wi->pending != 0xFF && t_now >= wi->t_deliver) {
+        int sym = wi->pending;
+        wi->pending = 0xFF;
+        deliver(w, sym);
+    }
+    if (t_now < wi->t_free || wi->head == wi->tail)
+        return;
+
+    int sym = wi->q[wi->tail++ % QLEN];
+    int t_high = sym == SYM_RESET ? T_RESET_H_US : sym ? T1H_US : T0H_US;
+    wi->pending = sym;
+    wi->t_deliver = t_now + t_high + T_HOP_US;
+    wi->t_free = t_now + (sym == SYM_RESET ? T_RESET_US : T_BIT_US);
+}
+
+/* Hooks for akela.c */
+bool akela_data_ready(void) { return rx_head != rx_tail; }
+int  akela_read(void)       { return rx_q[rx_tail++ % QLEN]; }
+void akela_write(int bit)   { send(0, bit); }
+
+/* Recovery from every resync */
+static uint32_t resyncs_seen, recoveries;
+static uint64_t recovery_sum_us;
+
+void akela_cry_start(uint64_t t_now_us)
+{
+    if (akela_stats.resyncs != resyncs_seen) {
+        resyncs_seen = akela_stats.resyncs;
+        recoveries++;
+        recovery_sum_us += akela_stats.recovery_last_us;
+    }
+}
+
+static uint64_t t_growl;            /* 0 if none is waiting */
+
+void akela_growl_at(uint64_t t_us)
+{
+    t_growl = t_us;
+    if (t_growl && t_growl <= t_now) {
+        send(0, 1);
+        send(0, 1);
+        t_growl = 0;
+    }
+}
+
+/* The alarm of akela_growl_at() */
+static void growl_step(void)
+{
+    if (t_growl && t_growl <= t_now)
+        akela_growl_at(t_growl);
+}
+
+static uint64_t t_last_cry;
+static uint32_t cry_min_us = -1, cry_max_us;
+static unsigned cry_off;            /* cries that took longer or shorter than the model */
+
+/* Key edges on their way to a keyboard report */
+static uint32_t events_tail;
+static uint64_t t_hid_next, pending_edges_us, pending_oldest_us;
+static bool key_seen[W];
+static unsigned pending;
+static uint64_t latency_sum_us, latencies;
+static uint32_t latency_max_us;
+static bool keys_still;
+static unsigned spurious;           /* streamed while keys_still, and wrong */
+
+static void key_latency(uint64_t t_now_us, bool streamed)
+{
+    struct key_event e;
+
+    while (key_event_next(&events_tail, &e) == 1) {
+        //A bad cry that passed as good is no matter of streaming, the
+        //events that set it right are fine
+        if (keys_still && streamed && e.down != rabies[e.rabi].key)
+            spurious++;
+        //Only the last edge of a key is known here. A glitch can make
+        //the Akela see it again, or one that never was and then take it
+        //back, those do not count
+        if (e.rabi >= W || e.down != rabies[e.rabi].key) continue;
+        if (e.down == key_seen[e.rabi]) continue;
+        key_seen[e.rabi] = e.down;
+        if (!pending++ || rabies[e.rabi].t_edge < pending_oldest_us)
+            pending_oldest_us = rabies[e.rabi].t_edge;
+        pending_edges_us += rabies[e.rabi].t_edge;
+    }
+    if (t_now_us < t_hid_next || !pending) return;
+    t_hid_next = t_now_us + HID_US;
+    //Their report. The oldest edge waited the longest
+    latency_sum_us += pending * t_now_us - pending_edges_us;
+    latencies += pending;
+    if (t_now_us - pending_oldest_us > latency_max_us)
+        latency_max_us = t_now_us - pending_oldest_us;
+    pending = 0;
+    pending_edges_us = 0;
+}
+
+/* One step of the simulation passes between the howl and the next growl */
+static struct canine_model model = {
+    .w = W, .k = K, .t_bit_us = T_BIT_US, .t1h_us = T1H_US,
+    .hop_us = T_HOP_US, .akela_us = 1, .delta = DELTA,
+};
+
+void akela_cry_done(uint64_t t_now_us, int n_rabies)
+{
+    unsigned glitches = 0;
+    for (int g = 0; g < G_N; g++)
+        glitches += glitch_cnt[g];
+
+    //Only while nothing went wrong yet. A glitch can leave the pack a bit
+    //out of phase, with cries that look fine
+    if (t_last_cry && !akela_stats.resyncs && !glitches) {
+        uint32_t t = t_now_us - t_last_cry;
+        if (t < cry_min_us) cry_min_us = t;
+        if (t > cry_max_us) cry_max_us = t;
+        model.changed = akela_stats.cry_frames;
+#if SCAN_US
+        cry_off += akela_stats.cry_last_us != canine_cry_us(&model) || t % SCAN_US;
+#else
+        cry_off += t != canine_cry_us(&model);
+#endif
+    }
+    t_last_cry = t_now_us;
+    key_latency(t_now_us, false);
+}
+
+#if STREAM
+void akela_stream(uint64_t t_now_us)
+{
+    key_latency(t_now_us, true);
+}
+
+/* A streamed frame goes out before the cry is checked. With the keys held
+ * still, a bit slipping in or out on the way to the Akela may not get an
+ * event to the firmware. A rabi that loses its place can still rewrite the
+ * frames after it into others that look fine, only the howl tells. */
+static void slip_pack(void)
+{
+    uint64_t t_glitch;
+    unsigned slips = 0;
+
+    //The Akela takes the pack back after topology_pack()
+    akela_init();
+    for (uint64_t t_end = t_now + QUIET_US; t_now < t_end; t_now++) {
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        growl_step();
+        akela_step(t_now);
+    }
+
+    keys_still = true;
+    t_glitch = t_now;
+    for (uint64_t t_end = t_now + SLIP_US + QUIET_US; t_now < t_end; t_now++) {
+        if (t_end - t_now > QUIET_US && t_now - t_glitch > GLITCH_GAP_US &&
+                rnd() % GLITCH_US == 0) {
+            if (rnd() & 1)
+                wires[W].glitch = G_DROP;
+            else
+                deliver(W, rnd() & 1);
+            slips++;
+            t_glitch = t_now;
+        }
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        growl_step();
+        akela_step(t_now);
+    }
+    keys_still = false;
+
+    printf("%u bit slips, %u spurious streamed key events\n", slips, spurious);
+    assert(slips && !spurious);
+    for (int i = 0; i < W; i++)
+        assert(KEY_LEVEL(key_states_read[i]) == rabies[i].key);
+}
+#endif
+
+static uint8_t image[SIM_PAGES * BULK_PAGE_SIZE];
+static uint64_t update_us;
+
+static bool output_idle(int w)
+{
+    return wires[w].head == wires[w].tail && t_now >= wires[w].t_free;
+}
+
+/* Update every rabi, some have no idea, some part of it, some another one */
+static void update_pack(void)
+{
+    unsigned pages = (UPDATE_SIZE + BULK_PAGE_SIZE - 1) / BULK_PAGE_SIZE;
+
+    memset(image, 0xFF, sizeof(image));
+    for (unsigned i = 0; i < UPDATE_SIZE; i++)
+        image[i] = rnd();
+    for (int i = 0; i < W; i++) {
+        struct rabi *r = &rabies[i];
+        switch (i % 3) {
+            case 0:
+                r->info = INFO_ERASED;
+                break;
+            case 1:
+                r->info = INFO_VALID;
+                r->info_pages = 5;
+                r->info_crc = crc16(CRC16_INIT, image, 5 * BULK_PAGE_SIZE);
+                memcpy(r->flash, image, 5 * BULK_PAGE_SIZE);
+                break;
+            case 2:
+                r->info = INFO_VALID;
+                r->info_pages = 20;
+                r->info_crc = 0x1234;
+                break;
+        }
+    }
+
+    unsigned glitches = 0;
+    for (int g = 0; g < G_N; g++)
+        glitches += glitch_cnt[g];
+
+    updating = true;
+    akela_stop();
+    assert(update_start(image, UPDATE_SIZE, W));
+    uint64_t t_start = t_now, t_glitch = t_now;
+    enum update_result result;
+    while ((result = update_step(t_now)) == UPDATE_BUSY) {
+        assert(t_now - t_start < UPDATE_MAX_US);
+        if (rnd() % UPDATE_GLITCH_US == 0 && t_now - t_glitch > GLITCH_GAP_US) {
+            glitch();
+            t_glitch = t_now;
+        }
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        for (int i = 0; i < W; i++)
+            if (rabies[i].pending && output_idle(i + 1))
+                rabi_pending(&rabies[i]);
+        t_now++;
+    }
+    for (int g = 0; g < G_N; g++)
+        glitches -= glitch_cnt[g];
+    updating = false;
+    update_us = t_now - t_start;
+
+    printf("update of %u pages: %.2f s, %u glitches, %u messages, %u pages sent, "
+            "%u bad echoes, %u verifies, %u dropped\n",
+            pages, (t_now - t_start) / 1e6, -glitches, update_stats.messages,
+            update_stats.pages_sent, update_stats.bad_echoes, update_stats.rounds, dropped);
+    assert(result == UPDATE_DONE);
+    assert(update_stats.rabies == W && update_stats.rabies_running == W);
+    for (int i = 0; i < W; i++) {
+        struct rabi *r = &rabies[i];
+        assert(!r->boot && r->info == INFO_VALID && r->info_pages == pages);
+        assert(!memcmp(r->flash, image, pages * BULK_PAGE_SIZE));
+    }
+
+    //And the Akela takes the pack back
+    uint32_t cries = akela_stats.cries;
+    akela_init();
+    for (uint64_t t_end = t_now + QUIET_US; t_now < t_end; t_now++) {
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        growl_step();
+        akela_step(t_now);
+    }
+    assert(akela_stats.cries > cries);
+    for (int i = 0; i < W; i++)
+        assert(KEY_LEVEL(key_states_read[i]) == rabies[i].key);
+}
+
+/* Map the pack, with a glitch now and then */
+static enum topology_result map_pack(struct topology *map)
+{
+    uint64_t t_start = t_now, t_glitch = t_now;
+    enum topology_result result;
+
+    updating = true;
+    akela_stop();
+    topology_start(map, W);
+    while ((result = topology_step(t_now)) == TOPOLOGY_BUSY) {
+        assert(t_now - t_start < UPDATE_MAX_US);
+        if (rnd() % UPDATE_GLITCH_US == 0 && t_now - t_glitch > GLITCH_GAP_US) {
+            glitch();
+            t_glitch = t_now;
+        }
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        t_now++;
+    }
+    updating = false;
+
+    printf("topology %s: %.1f ms, %u messages, %u bad echoes, %u hash reads, "
+            "%u uid reads, %d moved, %d found\n",
+            result == TOPOLOGY_SAME ? "same" : result == TOPOLOGY_CHANGED ? "changed" : "failed",
+            (t_now - t_start) / 1e3, topology_stats.messages, topology_stats.bad_echoes,
+            topology_stats.hash_reads, topology_stats.uid_reads,
+            topology_stats.moved, topology_stats.found);
+    assert(map->magic == TOPOLOGY_MAGIC && map->n == W);
+    for (int i = 0; i < W; i++)
+        assert(!memcmp(map->uid[i], rabies[i].uid, sizeof(rabies[i].uid)));
+    return result;
+}
+
+static void topology_pack(void)
+{
+    static struct topology map;
+    uint32_t uid[UID_WORDS];
+
+    for (int i = 0; i < W; i++)
+        for (int w = 0; w < UID_WORDS; w++)
+            rabies[i].uid[w] = rnd();
+
+    assert(map_pack(&map) == TOPOLOGY_CHANGED);
+    assert(topology_stats.found == W);
+    assert(map_pack(&map) == TOPOLOGY_SAME);
+    assert(topology_stats.hash_reads >= 1 && topology_stats.uid_reads == 0);
+
+    //Swap the first and the last, a new one in the middle
+    memcpy(uid, rabies[0].uid, sizeof(uid));
+    memcpy(rabies[0].uid, rabies[W - 1].uid, sizeof(uid));
+    memcpy(rabies[W - 1].uid, uid, sizeof(uid));
+    for (int w = 0; w < UID_WORDS; w++)
+        rabies[W / 2].uid[w] = rnd();
+    assert(map_pack(&map) == TOPOLOGY_CHANGED);
+    assert(topology_stats.found == 1 && topology_stats.moved == 2);
+    assert(topology_from[0] == W - 1 && topology_from[W - 1] == 0 && topology_from[W / 2] == -1);
+    for (int i = 1; i < W - 1; i++)
+        assert(i == W / 2 || topology_from[i] == i);
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = bench_name(argv[0]);
+    bool bench = argc > 1 && !strcmp(argv[1], "-b");
+
+    if (bench) {
+        argc--;
+        argv++;
+    }
+    if (argc > 1)
+        rnd_state = strtoul(argv[1], NULL, 0) | 1;
+
+    for (int w = 0; w <= W; w++)
+        wires[w].pending = 0xFF;
+    for (int i = 0; i < W; i++)
+        rabies[i].bark_i = FRAME_LEN;
+
+    akela_init();
+
+    uint32_t cooldowns_at_start = 0;
+    uint64_t t_glitch = 0;
+    for (t_now = 0; t_now < SIM_US; t_now++) {
+        bool quiet = t_now >= SIM_US - QUIET_US;
+
+        //The very first reset only comes after the cooldown
+        if (t_now == 2 * WATCHDOG_TIMEOUT)
+            cooldowns_at_start = akela_stats.cooldowns;
+
+        if (!quiet && t_now > 2 * WATCHDOG_TIMEOUT) {
+            if (rnd() % GLITCH_US == 0 && t_now - t_glitch > GLITCH_GAP_US) {
+                glitch();
+                t_glitch = t_now;
+            }
+            if (rnd() % KEY_US == 0) {
+                int i = rnd() % W;
+                rabies[i].key = !rabies[i].key;
+                rabies[i].t_edge = t_now;
+            }
+        }
+        for (int w = 0; w <= W; w++)
+            wire_step(w);
+        growl_step();
+        akela_step(t_now);
+    }
+
+    model.changed = W;
+    printf("W=%d K=%d%s cry %u..%u us (model %.0f us), PACK_TIMEOUT %u us, recovery bound %u us\n",
+            W, K, DELTA ? " delta" : "", cry_min_us, cry_max_us, canine_cry_us(&model),
+            PACK_TIMEOUT, RESYNC_TRIES * PACK_TIMEOUT);
+    for (int g = 1; g < G_N; g++)
+        printf("\t%-16s %u\n", glitch_names[g], glitch_cnt[g]);
+    printf("cries %u, bad frames %u, resyncs %u, resets %u, cooldowns %u\n",
+            akela_stats.cries, akela_stats.bad_frames, akela_stats.resyncs,
+            akela_stats.resets, akela_stats.cooldowns);
+    printf("recovery last %u us, max %u us\n",
+            akela_stats.recovery_last_us, akela_stats.recovery_max_us);
+#if SCAN_US
+    printf("scan %u us (SCAN_US %u), busy %u us, overruns %u\n", akela_stats.scan_us,
+            SCAN_US, akela_stats.scan_busy_us, akela_stats.scan_overruns);
+    //Stretched to the slots the cry needs, no more
+    assert(akela_stats.scan_us >= akela_stats.scan_busy_us);
+    assert(akela_stats.scan_us < akela_stats.scan_busy_us + SCAN_US);
+#endif
+
+    //The model has it right
+    assert(cry_max_us && cry_off == 0);
+    assert(DELTA || cry_min_us == cry_max_us);
+    //Isolated glitches never need the slow road
+    assert(akela_stats.cooldowns == cooldowns_at_start);
+    assert(akela_stats.resyncs > 0);
+    assert(akela_stats.recovery_max_us <= RESYNC_TRIES * PACK_TIMEOUT);
+    //After a quiet spell the Akela knows every key
+    for (int i = 0; i < W; i++)
+        assert(KEY_LEVEL(key_states_read[i]) == rabies[i].key);
+
+    update_pack();
+    topology_pack();
+
+    if (bench) {
+        bench_result(name, "cry_us", cry_max_us, false, BENCH_SIM_TOL);
+        bench_result(name, "scan_hz", akela_stats.cries / (SIM_US / 1e6), true, BENCH_SIM_TOL);
+        bench_result(name, "recovery_mean_us", recovery_sum_us / (double)recoveries, false, BENCH_SIM_TOL);
+        bench_result(name, "recovery_max_us", akela_stats.recovery_max_us, false, BENCH_SIM_TOL);
+        bench_result(name, "key_latency_mean_us", latency_sum_us / (double)latencies, false, BENCH_SIM_TOL);
+        bench_result(name, "key_latency_max_us", latency_max_us, false, BENCH_SIM_TOL);
+        bench_result(name, "update_ms", update_us / 1e3, false, BENCH_SIM_TOL);
+    }
+#if STREAM
+    slip_pack();
+#endif
+    printf("OK\n");
+    return 0;
+}
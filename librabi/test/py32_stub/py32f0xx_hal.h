@@ -0,0 +1,7 @@
+#ifndef PY32F0XX_HAL_H
+#define PY32F0XX_HAL_H
+/* Just enough of the PY32 HAL to build raddr/pack.c on the host */
+
+#define HSI_VALUE 24000000
+
+#endif
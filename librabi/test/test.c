@@ -51,7 +51,7 @@ void test_n_neighbours(int n)
     while (n--) {
         printf("NEIGHBOUR -%d BARK\n", n);
         output(BARK, BARK);
-        for (int k = 0; k<K; k++) {
+        for (int k = 0; k<K+1; k++) { //K bits and parity
             output(1, 1);
         }
     }
@@ -0,0 +1,187 @@
+/**
+ * Reverse Addressable Binary Input
+ * Who is where in the pack, the Akela side. See topology.h
+ **/
+
+#include <string.h>
+#include "topology.h"
+
+struct topology_stats topology_stats;
+int8_t topology_from[W];
+
+static struct topology *map;
+static int rabies;
+
+static enum {T_HASH, T_WORDS, T_OVER} phase;
+static enum topology_result result;
+static unsigned rounds;                 //queries gone wrong, in this phase
+static bool confirmed;                  //hashes read twice the same
+
+static int n;
+static uint32_t hash[W];
+static unsigned word;                   //of the UIDs being read
+static uint32_t uid[W][UID_WORDS];      //of the ones we did not know
+
+static void send_uid(uint8_t w)
+{
+    bulk_send(BULK_UID, &w, 1, 0);
+    topology_stats.messages++;
+    if (w == UID_HASH)
+        topology_stats.hash_reads++;
+    else
+        topology_stats.uid_reads++;
+}
+
+static void over(enum topology_result r)
+{
+    phase = T_OVER;
+    result = r;
+}
+
+/* Where the rabi with hash h was in the map, -1 if nowhere */
+static int find(uint32_t h, int i)
+{
+    int known = map->magic == TOPOLOGY_MAGIC ? map->n : 0;
+
+    //Most stay where they are
+    if (i < known && uid_hash(map->uid[i]) == h)
+        return i;
+    for (int j = 0; j < known; j++)
+        if (uid_hash(map->uid[j]) == h)
+            return j;
+    return -1;
+}
+
+/* Everyone is known now, make it the map */
+static void make_map(void)
+{
+    static uint32_t old[W][UID_WORDS];
+    bool same = map->magic == TOPOLOGY_MAGIC && map->n == (uint32_t)n;
+
+    memcpy(old, map->uid, sizeof(old));
+    topology_stats.moved = topology_stats.found = 0;
+    for (int i = 0; i < n; i++) {
+        int j = topology_from[i];
+        if (j < 0) {
+            memcpy(map->uid[i], uid[i], sizeof(uid[i]));
+            topology_stats.found++;
+        } else {
+            memcpy(map->uid[i], old[j], sizeof(old[j]));
+            topology_stats.moved += j != i;
+        }
+        same &= j == i;
+    }
+    memset(map->uid[n], 0, (W - n) * sizeof(map->uid[0]));
+    map->magic = TOPOLOGY_MAGIC;
+    map->n = n;
+    over(same ? TOPOLOGY_SAME : TOPOLOGY_CHANGED);
+}
+
+static void read_words(void)
+{
+    if (phase == T_HASH)
+        rounds = 0;
+    word = 0;
+    phase = T_WORDS;
+    send_uid(word);
+}
+
+static void hashes(void)
+{
+    bool known = true;
+
+    //A glitch can cut the query short, but never make it longer
+    if (bulk_reply.n > rabies)
+        rabies = bulk_reply.n;
+    if (bulk_reply.bad || bulk_reply.n < rabies) {
+        confirmed = false;
+        if (++rounds >= TOPOLOGY_ROUNDS)
+            over(TOPOLOGY_FAILED);
+        else
+            send_uid(UID_HASH);
+        return;
+    }
+
+    //Read twice the same, a flipped bit in an answer goes unnoticed otherwise
+    confirmed = n == bulk_reply.n && !memcmp(hash, bulk_reply.answer, n * sizeof(hash[0]));
+    n = bulk_reply.n;
+    memcpy(hash, bulk_reply.answer, n * sizeof(hash[0]));
+    for (int i = 0; i < n; i++) {
+        topology_from[i] = find(hash[i], i);
+        known &= topology_from[i] == i;
+    }
+    //The map as it was is confirmation enough
+    known &= map->magic == TOPOLOGY_MAGIC && map->n == (uint32_t)n;
+    if (known) {
+        over(TOPOLOGY_SAME);
+        return;
+    }
+    if (!confirmed) {
+        if (++rounds >= TOPOLOGY_ROUNDS)
+            over(TOPOLOGY_FAILED);
+        else
+            send_uid(UID_HASH);
+        return;
+    }
+    for (int i = 0; i < n; i++)
+        if (topology_from[i] < 0) {
+            read_words();
+            return;
+        }
+    make_map();
+}
+
+static void words(void)
+{
+    if (bulk_reply.bad || bulk_reply.n != n) {
+        if (++rounds >= TOPOLOGY_ROUNDS)
+            over(TOPOLOGY_FAILED);
+        else
+            send_uid(word);
+        return;
+    }
+
+    for (int i = 0; i < n; i++)
+        uid[i][word] = bulk_reply.answer[i];
+    if (++word < UID_WORDS) {
+        send_uid(word);
+        return;
+    }
+    //The hash has our back, one that does not match is read again
+    for (int i = 0; i < n; i++)
+        if (topology_from[i] < 0 && uid_hash(uid[i]) != hash[i]) {
+            if (++rounds >= TOPOLOGY_ROUNDS)
+                over(TOPOLOGY_FAILED);
+            else
+                read_words();
+            return;
+        }
+    make_map();
+}
+
+void topology_start(struct topology *m, int r)
+{
+    map = m;
+    rabies = r;
+    n = 0;
+    rounds = 0;
+    confirmed = false;
+    memset(&topology_stats, 0, sizeof(topology_stats));
+    memset(topology_from, -1, sizeof(topology_from));
+    phase = T_HASH;
+    send_uid(UID_HASH);
+}
+
+enum topology_result topology_step(uint64_t t_now_us)
+{
+    if (phase == T_OVER || !bulk_send_step(t_now_us))
+        return phase == T_OVER ? result : TOPOLOGY_BUSY;
+
+    if (bulk_reply.bad)
+        topology_stats.bad_echoes++;
+    if (phase == T_HASH)
+        hashes();
+    else
+        words();
+    return phase == T_OVER ? result : TOPOLOGY_BUSY;
+}
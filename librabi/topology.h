@@ -0,0 +1,59 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+/**
+ * Reverse Addressable Binary Input
+ * Who is where in the pack, the Akela side
+ *
+ * Every rabi answers BULK_UID with a word of the unique ID of its MCU, or a
+ * hash of it. A map of the pack is the UID at every position. To check one
+ * against the pack we only read the hashes, one query. If a rabi was moved
+ * or swapped, its hash is found elsewhere in the map and it keeps its UID.
+ * Only positions with a hash we do not know have their UID read:
+ *
+ *   HASH -> [HASH again, to be sure] -> [word 0..3] -> map
+ *
+ * Whatever belongs to a rabi, a keymap or a calibration, can follow it with
+ * topology_from[].
+ **/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bulk_send.h"
+
+#define TOPOLOGY_MAGIC      0x544F504F      //"TOPO"
+#define TOPOLOGY_ROUNDS     8               //queries gone wrong before we give up
+
+struct topology {
+    uint32_t magic;
+    uint32_t n;                             //rabies
+    uint32_t uid[W][UID_WORDS];             //from the Akela on
+};
+
+enum topology_result {
+    TOPOLOGY_BUSY,
+    TOPOLOGY_SAME,          /* the map is the pack */
+    TOPOLOGY_CHANGED,       /* the map was updated */
+    TOPOLOGY_FAILED,        /* the map is as it was */
+};
+
+struct topology_stats {
+    uint32_t messages;      /* sent */
+    uint32_t bad_echoes;
+    uint32_t hash_reads;    /* queries for the hashes */
+    uint32_t uid_reads;     /* queries for a word of the UIDs */
+    int moved;              /* rabies found at another position */
+    int found;              /* rabies not in the map before */
+};
+extern struct topology_stats topology_stats;
+
+/* Where the rabi at i was in the map before, -1 if it was not */
+extern int8_t topology_from[W];
+
+/* Check the map against the pack, a map without TOPOLOGY_MAGIC is empty. It
+ * has to stay around until topology_step() is done with it. Pass the
+ * rabies the Akela saw in its last cry, 0 when it does not know. */
+void topology_start(struct topology *map, int rabies);
+/* Run it for a bit. Call this instead of akela_step(), akela_init() after */
+enum topology_result topology_step(uint64_t t_now_us);
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * Reverse Addressable Binary Input
+ * Firmware update of the whole pack, the Akela side. See update.h
+ **/
+
+#include <string.h>
+#include "update.h"
+
+struct update_stats update_stats;
+
+static const uint8_t *image;
+static unsigned image_size;
+static uint16_t prefix_crc[UPDATE_PAGES_MAX + 1];  //of the first n pages
+
+static enum {U_VERIFY, U_UPDATE, U_PAGES, U_RUN, U_OVER} phase;
+static enum update_result result;
+static unsigned from;                   //first page someone misses
+static unsigned tries;                  //of the same page
+
+static uint8_t data[BULK_DATA_MAX];
+
+static void page_data(unsigned p, uint8_t *buf)
+{
+    unsigned offset = p * BULK_PAGE_SIZE;
+    for (unsigned i = 0; i < BULK_PAGE_SIZE; i++)
+        buf[i] = offset + i < image_size ? image[offset + i] : 0xFF;
+}
+
+static void send(uint8_t hdr, unsigned n, uint32_t wait_us)
+{
+    bulk_send(hdr, data, n, wait_us);
+    update_stats.messages++;
+}
+
+static void send_page(void)
+{
+    unsigned len = 1 + BULK_PAGE_SIZE;
+
+    data[0] = update_stats.page = from;
+    page_data(from, &data[1]);
+    uint16_t crc = crc16(CRC16_INIT, data, len);
+    data[len] = crc >> 8;
+    data[len + 1] = crc;
+    update_stats.pages_sent++;
+    phase = U_PAGES;
+    //Starting over costs the bootloader the info page as well
+    send(BULK_PAGE, len + 2, from ? UPDATE_WRITE_US : 2 * UPDATE_WRITE_US);
+    from++;
+}
+
+static void send_verify(void)
+{
+    phase = U_VERIFY;
+    send(BULK_VERIFY, 0, 0);
+}
+
+static void send_run(void)
+{
+    data[0] = update_stats.pages;
+    data[1] = prefix_crc[update_stats.pages] >> 8;
+    data[2] = prefix_crc[update_stats.pages];
+    phase = U_RUN;
+    send(BULK_RUN, 3, UPDATE_BOOT_US);
+}
+
+static void over(enum update_result r)
+{
+    phase = U_OVER;
+    result = r;
+}
+
+/* Every rabi answered flags, pages and crc16 */
+static void verified(void)
+{
+    int rabies = update_stats.rabies;
+    bool need_boot = false;
+
+    update_stats.rounds++;
+    //A glitch can cut the query short, but never make it longer
+    if (bulk_reply.n > rabies)
+        rabies = update_stats.rabies = bulk_reply.n;
+    if (bulk_reply.bad || bulk_reply.n < rabies) {
+        if (update_stats.rounds >= UPDATE_ROUNDS)
+            over(UPDATE_FAILED);
+        else
+            send_verify();
+        return;
+    }
+
+    update_stats.rabies_done = update_stats.rabies_running = 0;
+    from = update_stats.pages;
+    for (int i = 0; i < bulk_reply.n; i++) {
+        uint32_t a = bulk_reply.answer[i];
+        unsigned flags = a >> 24;
+        unsigned n = (a >> 16) & 0xFF;
+        //Only good as far as it is our image
+        if (n > update_stats.pages || (a & 0xFFFF) != prefix_crc[n])
+            n = 0;
+        if (n == update_stats.pages) {
+            update_stats.rabies_done++;
+            update_stats.rabies_running += !!(flags & BULK_APP);
+        } else if (flags & BULK_APP) {
+            need_boot = true;
+        }
+        if (n < from)
+            from = n;
+    }
+
+    if (update_stats.rabies_running == rabies)
+        over(UPDATE_DONE);
+    else if (update_stats.rounds >= UPDATE_ROUNDS)
+        over(UPDATE_FAILED);
+    else if (update_stats.rabies_done == rabies)
+        send_run();
+    else if (need_boot) {
+        phase = U_UPDATE;
+        send(BULK_UPDATE, 0, UPDATE_BOOT_US);
+    } else
+        send_page();
+}
+
+/* The message is over, what is next */
+static void next(void)
+{
+    bool bad = bulk_reply.bad;
+
+    if (bad)
+        update_stats.bad_echoes++;
+
+    switch (phase) {
+        case U_VERIFY:
+            verified();
+            break;
+        case U_UPDATE:
+            send_page();
+            break;
+        case U_PAGES:
+            //Someone missed it, likely. Again, before the others are ahead
+            if (bad && ++tries < RESYNC_TRIES) {
+                from--;
+                send_page();
+                break;
+            }
+            tries = 0;
+            if (from < update_stats.pages)
+                send_page();
+            else
+                send_verify();
+            break;
+        case U_RUN:
+            send_verify();
+            break;
+        case U_OVER:
+            break;
+    }
+}
+
+bool update_start(const uint8_t *img, unsigned size, int rabies)
+{
+    unsigned pages = (size + BULK_PAGE_SIZE - 1) / BULK_PAGE_SIZE;
+
+    if (!size || pages > UPDATE_PAGES_MAX)
+        return false;
+
+    image = img;
+    image_size = size;
+    memset(&update_stats, 0, sizeof(update_stats));
+    update_stats.pages = pages;
+    update_stats.rabies = rabies;
+
+    uint8_t buf[BULK_PAGE_SIZE];
+    prefix_crc[0] = CRC16_INIT;
+    for (unsigned p = 0; p < pages; p++) {
+        page_data(p, buf);
+        prefix_crc[p + 1] = crc16(prefix_crc[p], buf, BULK_PAGE_SIZE);
+    }
+
+    //Maybe there is nothing to do
+    send_verify();
+    return true;
+}
+
+enum update_result update_step(uint64_t t_now_us)
+{
+    if (phase != U_OVER && bulk_send_step(t_now_us))
+        next();
+    return phase == U_OVER ? result : UPDATE_BUSY;
+}
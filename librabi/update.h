@@ -0,0 +1,52 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+/**
+ * Reverse Addressable Binary Input
+ * Firmware update of the whole pack, the Akela side
+ *
+ * Streams an application image to the bootloader of every rabi at once,
+ * with the bulk messages of bulk.h. Every message is copied by every rabi,
+ * so one pass over the pages updates the pack. Then a query collects the
+ * pages and crc16 every rabi has, the pages someone misses are sent again
+ * and when all agree the pack is told to run it:
+ *
+ *   VERIFY -> [UPDATE] -> PAGE from..pages -> VERIFY -> .. -> RUN -> VERIFY
+ *
+ * The messages go out with bulk_send.h, call akela_init() once it is done.
+ **/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bulk_send.h"
+
+#define UPDATE_PAGES_MAX    255             /* the page number is 8 bits */
+#define UPDATE_ROUNDS       16              /* verifies before we give up */
+#define UPDATE_WRITE_US     (12 * 1000)     /* erase and program a page */
+#define UPDATE_BOOT_US      (100 * 1000)    /* start the bootloader or the application */
+
+enum update_result {
+    UPDATE_BUSY,
+    UPDATE_DONE,
+    UPDATE_FAILED,
+};
+
+struct update_stats {
+    uint32_t messages;          /* sent */
+    uint32_t bad_echoes;        /* came back different, or not at all */
+    uint32_t pages_sent;
+    uint32_t rounds;            /* verifies */
+    unsigned pages;             /* in the image */
+    unsigned page;              /* being sent */
+    int rabies;                 /* in the pack, the most that ever answered */
+    int rabies_done;            /* that have the image, last verify */
+    int rabies_running;         /* that run it, last verify */
+};
+extern struct update_stats update_stats;
+
+/* The image has to stay around until update_step() is done with it. Pass
+ * the rabies the Akela saw in its last cry, 0 when it does not know. */
+bool update_start(const uint8_t *image, unsigned size, int rabies);
+/* Run the update for a bit. Call this instead of akela_step() */
+enum update_result update_step(uint64_t t_now_us);
+
+#endif
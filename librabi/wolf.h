@@ -15,13 +15,6 @@
 #define BARK 0
 #define HOWL 1
 
-enum states {
-    S_REST,       //do nothing
-    S_ALERT,      //listen for howl
-    S_HOWL,       //transmit frame
-    S_BARK        //copy frame
-};
-
 extern void gpio_set(int);
 extern void sleep_ns(int);
 extern int gpio_get(void);
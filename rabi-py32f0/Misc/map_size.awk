@@ -0,0 +1,71 @@
+# Flash and RAM per module, from the map file of the linker:
+#   awk -f Misc/map_size.awk Build/app.map
+# Only what survived --gc-sections is in there. With -flto the modules are
+# merged into one, build with LTO=n for this.
+
+function hex(s,    i, c, v)
+{
+    v = 0
+    s = tolower(substr(s, 3))
+    for (i = 1; i <= length(s); i++) {
+        c = index("0123456789abcdef", substr(s, i, 1))
+        v = v * 16 + c - 1
+    }
+    return v
+}
+
+# The module of an input section: the object, or the archive it came from
+function module(s)
+{
+    sub(/\(.*\)$/, "", s)
+    sub(/^\.\//, "", s)
+    sub(/^(.*\/)?Build\//, "", s)
+    if (s ~ /^\//)
+        sub(/^.*\//, "", s)
+    return s
+}
+
+function add(name, addr, size, obj,    m)
+{
+    if (hex(size) == 0 || hex(addr) == 0)
+        return
+    m = module(obj)
+    if (name ~ /^\.(text|rodata|isr_vector|init|fini|ARM)/)
+        flash[m] += hex(size)
+    else if (name ~ /^\.data/) {
+        flash[m] += hex(size)
+        ram[m] += hex(size)
+    } else if (name ~ /^(\.bss|COMMON)/)
+        ram[m] += hex(size)
+    else
+        return
+    seen[m] = 1
+}
+
+/^Linker script and memory map/ { map = 1; next }
+!map { next }
+
+# An input section, its name alone on a line when it is long
+/^ [.A-Z]/ {
+    if (NF == 4 && $2 ~ /^0x/ && $3 ~ /^0x/)
+        add($1, $2, $3, $4)
+    else if (NF == 1)
+        pending = $1
+    next
+}
+pending != "" {
+    if (NF == 3 && $1 ~ /^0x/ && $2 ~ /^0x/)
+        add(pending, $1, $2, $3)
+    pending = ""
+}
+
+END {
+    printf "%8s %8s  %s\n", "flash", "ram", "module"
+    for (m in seen) {
+        printf "%8d %8d  %s\n", flash[m], ram[m], m | "sort -rn"
+        tf += flash[m]
+        tr += ram[m]
+    }
+    close("sort -rn")
+    printf "%8d %8d  %s\n", tf, tr, "total"
+}
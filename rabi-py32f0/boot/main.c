@@ -0,0 +1,246 @@
+/**
+ * Reverse Addressable Binary Input
+ * Bootloader: updates the application over the CANINE line
+ *
+ * Runs the pack code of raddr/ like the application does, so the pack keeps
+ * working with a rabi in here: it answers polls with its switch. On top of
+ * that it takes the bulk messages of a firmware update, see librabi/bulk.h:
+ *
+ *   BULK_PAGE      page p of the application, taken if p is the next one,
+ *                  or 0 to start over
+ *   BULK_VERIFY    answers the pages so far and their crc16
+ *   BULK_RUN       if pages and crc16 match: mark it valid and run it
+ *   BULK_UID       our unique ID, like the application
+ *
+ * Writing flash stalls the CPU, so that waits until the message is on its
+ * way and our output is idle. The Akela gives us time for it.
+ *
+ * After power up the application runs if it is valid. After a software
+ * reset, the application asking for an update, we stay.
+ **/
+#include <string.h>
+#include "hw.h"
+#ifdef USE_FULL_LL_DRIVER
+#include "py32f0xx_ll_flash.h"
+#endif
+#include "clk_config.h"
+#include "gpio.h"
+
+#include "output_timer.h"
+#include "input_capture.h"
+#include "wolf.h"
+#include "pack.h"
+#include "pins.h"
+#include "debounce.h"
+#include "boot.h"
+#include "uid.h"
+#include "trim.h"
+
+bool K_BINARY_INPUTS[K] = {0};
+
+/* Only the switch, the age of its edge stays 0 */
+void update_input(void)
+{
+}
+
+/* The application so far */
+static uint32_t next_page;
+static uint16_t crc;
+
+/* Flash work for the main loop */
+static enum {NONE, WRITE_PAGE, RUN} pending;
+static uint8_t pending_page;
+static uint32_t page_buf[BULK_PAGE_SIZE / 4];
+
+static void flash_page(uint32_t addr, const uint32_t *data)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGEERASE,
+        .PageAddress = addr,
+        .NbPages = 1,
+    };
+    uint32_t error;
+
+#ifdef USE_FULL_LL_DRIVER
+    LL_FLASH_Unlock();
+    LL_FLASH_Erase(&erase, &error);
+    LL_FLASH_PageProgram(addr, (uint32_t *)data);
+    LL_FLASH_Lock();
+#else
+    HAL_FLASH_Unlock();
+    HAL_FLASH_Erase(&erase, &error);
+    HAL_FLASH_Program(FLASH_TYPEPROGRAM_PAGE, addr, (uint32_t *)data);
+    HAL_FLASH_Lock();
+#endif
+}
+
+static void write_info(uint32_t magic)
+{
+    static uint32_t buf[BULK_PAGE_SIZE / 4];
+    struct boot_info *info = (struct boot_info *)buf;
+
+    memset(buf, 0xFF, sizeof(buf));
+    info->magic = magic;
+    info->pages = next_page;
+    info->crc = crc;
+    flash_page(INFO_ADDR, buf);
+}
+
+static bool app_valid(void)
+{
+    const struct boot_info *info = boot_info();
+    const uint32_t *vectors = (const uint32_t *)APP_ADDR;
+
+    //Flashed with SWD, trust it if it looks like one
+    if (info->magic == 0xFFFFFFFF)
+        return (vectors[0] & 0xFFFF0000) == SRAM_BASE;
+    if (info->magic != INFO_VALID || !info->pages || info->pages > APP_PAGES)
+        return false;
+    return crc16(CRC16_INIT, (const uint8_t *)APP_ADDR,
+            info->pages * BULK_PAGE_SIZE) == info->crc;
+}
+
+/* As if we came out of reset, its SystemInit() moves VTOR */
+static void run_app(void)
+{
+    const uint32_t *vectors = (const uint32_t *)APP_ADDR;
+
+    __disable_irq();
+    SysTick->CTRL = 0;
+    //What HAL_DeInit() does, the peripherals back to reset
+    RCC->APBRSTR1 = ~0u;
+    RCC->APBRSTR1 = 0;
+    RCC->APBRSTR2 = ~0u;
+    RCC->APBRSTR2 = 0;
+    RCC->AHBRSTR = ~0u;
+    RCC->AHBRSTR = 0;
+    RCC->IOPRSTR = ~0u;
+    RCC->IOPRSTR = 0;
+    NVIC->ICER[0] = 0xFFFFFFFF;
+    NVIC->ICPR[0] = 0xFFFFFFFF;
+    SCB->VTOR = APP_ADDR;
+    __set_MSP(vectors[0]);
+    __enable_irq();
+    ((void (*)(void))vectors[1])();
+}
+
+void bulk_message(const struct bulk *b)
+{
+    switch (b->hdr) {
+        case BULK_PAGE: {
+            unsigned len = 1 + BULK_PAGE_SIZE;
+            uint8_t p = b->data[0];
+            if (crc16(CRC16_INIT, b->data, len) != (b->data[len] << 8 | b->data[len + 1]))
+                return;
+            if (p >= APP_PAGES || (p != next_page && p != 0))
+                return;
+            memcpy(page_buf, &b->data[1], BULK_PAGE_SIZE);
+            pending_page = p;
+            pending = WRITE_PAGE;
+            break;
+        }
+        case BULK_RUN:
+            if (b->data[0] == next_page && (b->data[1] << 8 | b->data[2]) == crc && next_page)
+                pending = RUN;
+            break;
+    }
+}
+
+uint32_t bulk_answer(const struct bulk *b)
+{
+    if (b->hdr == BULK_UID)
+        return uid_word(b->data[0]);
+    return next_page << 16 | crc;
+}
+
+static void do_pending(void)
+{
+    switch (pending) {
+        case WRITE_PAGE:
+            if (!pending_page) {
+                //Starting over, the old one is history
+                next_page = 0;
+                crc = CRC16_INIT;
+                write_info(INFO_BUSY);
+            }
+            flash_page(APP_ADDR + pending_page * BULK_PAGE_SIZE, page_buf);
+            crc = crc16(crc, (const uint8_t *)page_buf, BULK_PAGE_SIZE);
+            next_page = pending_page + 1;
+            break;
+        case RUN:
+            write_info(INFO_VALID);
+            run_app();
+            break;
+        case NONE:
+            break;
+    }
+    pending = NONE;
+}
+
+static void cfg_gpio(void)
+{
+    SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOAEN);
+    gpio_cfg(SWC_PIN,     PIN_INPUT, PIN_PULLUP);
+    gpio_irq_both_edges(SWC_PIN);
+    gpio_af(KEY_IN_PIN, KEY_IN_AF, true);
+    gpio_cfg(KEY_IN_PIN,  PIN_AF, PIN_PULLUP);
+    gpio_cfg(KEY_OUT_PIN, PIN_OUTPUT, PIN_NOPULL);
+
+    NVIC_SetPriority(EXTI0_1_IRQn, 2);
+    NVIC_EnableIRQ(EXTI0_1_IRQn);
+}
+
+int main(void)
+{
+    uint32_t csr = RCC->CSR;
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    BSP_HSI_24MHzClockConfig();
+    tick_init();
+
+    if (!(csr & RCC_CSR_SFTRSTF) && app_valid())
+        run_app();
+#ifdef USE_HSI_TRIM
+    trim_init();
+#endif
+
+    //Carry on where a complete one left off, the Akela may not need to send a thing
+    const struct boot_info *info = boot_info();
+    crc = CRC16_INIT;
+    if (info->magic == INFO_VALID && info->pages <= APP_PAGES) {
+        next_page = info->pages;
+        crc = info->crc;
+    }
+
+    cfg_gpio();
+    raddr_output_init();
+    raddr_input_capture_init();
+    debounce_init();
+
+    while (1) {
+        if (pending && raddr_output_idle())
+            do_pending();
+
+        if (!receive_bits_available())
+            continue;
+
+        int bit = receive_bit();
+
+        switch(bit) {
+            case 0 ... 1:
+                join_cry(bit, CRY_OKAY);
+                break;
+            case -1:
+                join_cry(!GROWL, CRY_RESET);
+                raddr_output_flush();
+                raddr_output_schedule(1, us_to_timer_tick(TRESET));
+                raddr_output_schedule(0, us_to_timer_tick(TRESET / 2));
+                break;
+        }
+    }
+}
+
+void APP_ErrorHandler(void)
+{
+    while (1);
+}
@@ -0,0 +1,45 @@
+#ifndef BOOT_H
+#define BOOT_H
+/**
+ * Flash layout of a rabi with the bootloader, see boot/main.c
+ *
+ *   0x08000000  bootloader          BOOT_SIZE
+ *   APP_ADDR    the application     APP_PAGES pages, raddr/app.ld
+ *   INFO_ADDR   boot_info           the last page
+ **/
+#include <stdint.h>
+#include <stdbool.h>
+#include "bulk.h"
+
+#define FLASH_START     0x08000000
+#define FLASH_TOTAL     (20 * 1024)
+#define BOOT_SIZE       (6 * 1024)
+#define APP_ADDR        (FLASH_START + BOOT_SIZE)
+#define INFO_ADDR       (FLASH_START + FLASH_TOTAL - BULK_PAGE_SIZE)
+#define APP_PAGES       ((INFO_ADDR - APP_ADDR) / BULK_PAGE_SIZE)
+
+/* The info page. Erased when the application was flashed with SWD */
+#define INFO_VALID      0x52414249      //"RABI", the application is complete
+#define INFO_BUSY       0x42555359      //being updated, do not run it
+
+struct boot_info {
+    uint32_t magic;
+    uint32_t pages;
+    uint32_t crc;           //crc16 of the data of those pages
+};
+
+static inline const struct boot_info *boot_info(void)
+{
+    return (const struct boot_info *)INFO_ADDR;
+}
+
+/* What we answer to BULK_VERIFY from the application */
+static inline uint32_t boot_info_answer(void)
+{
+    const struct boot_info *info = boot_info();
+    if (info->magic != INFO_VALID)
+        return BULK_APP << 24 | CRC16_INIT;
+    return BULK_APP << 24 | info->pages << 16 | info->crc;
+}
+
+#endif
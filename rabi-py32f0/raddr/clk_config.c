@@ -1,6 +1,44 @@
-#include <py32f0xx_hal.h>
-#include <py32f0xx_hal_rcc.h>
+#include "hw.h"
+#include "clk_config.h"
 
+#ifdef USE_FULL_LL_DRIVER
+static volatile uint32_t ms;
+
+/* Setup the clocking infrastructure to use:
+ *  internal oscillator @ 24Mhz
+ *  AHB: 24Mhz
+ *  APB: 24Mhz
+ * */
+void BSP_HSI_24MHzClockConfig(void)
+{
+  LL_RCC_HSI_Enable();
+  LL_RCC_HSI_SetCalibFreq(LL_RCC_HSICALIBRATION_24MHz);
+  while (LL_RCC_HSI_IsReady() != 1);
+
+  LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+  LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSISYS);
+  while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSISYS);
+
+  LL_FLASH_SetLatency(LL_FLASH_LATENCY_0);
+  LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_1);
+  LL_SetSystemCoreClock(HSI_VALUE);
+}
+
+void tick_init(void)
+{
+  SysTick_Config(HSI_VALUE / 1000);
+}
+
+void tick_inc(void)
+{
+  ms++;
+}
+
+uint32_t time_ms(void)
+{
+  return ms;
+}
+#else
 static RCC_OscInitTypeDef RCC_OscInitStruct = {
   .OscillatorType = RCC_OSCILLATORTYPE_HSI,
   .HSIState = RCC_HSI_ON,                            /* HSI ON */
@@ -37,4 +75,37 @@ void BSP_HSI_24MHzClockConfig(void) {
   HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0);
 }
 
+/* The HAL keeps the tick, its drivers time out on it */
+void tick_init(void)
+{
+  HAL_Init();
+}
+
+void tick_inc(void)
+{
+  HAL_IncTick();
+}
 
+uint32_t time_ms(void)
+{
+  return HAL_GetTick();
+}
+#endif
+
+/* Microseconds since boot. Wraps after ~71 minutes.
+ * Built from the millisecond tick and the SysTick down counter. Safe to
+ * call from any ISR, even one that preempted a pending SysTick. */
+uint32_t time_us(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t ms = time_ms();
+  uint32_t val = SysTick->VAL;
+  if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+    /* SysTick wrapped, but its ISR did not run yet */
+    ms++;
+    val = SysTick->VAL;
+  }
+  __set_PRIMASK(primask);
+  return ms * 1000 + (SysTick->LOAD - val) / (HSI_VALUE / 1000000);
+}
@@ -1,2 +1,10 @@
 #pragma once
+#include <stdint.h>
+
 void BSP_HSI_24MHzClockConfig(void);
+/* The 1kHz SysTick, right after the clock. In place of HAL_Init() */
+void tick_init(void);
+/* To be called from the SysTick ISR */
+void tick_inc(void);
+uint32_t time_ms(void);
+uint32_t time_us(void);
@@ -0,0 +1,82 @@
+#include <stdbool.h>
+#include "hw.h"
+#include "clk_config.h"
+#include "wolf.h"
+#include "pins.h"
+#include "debounce.h"
+
+/* Eager debouncer for the switch.
+ *
+ * The first edge is reported from the EXTI ISR the moment it happens. After
+ * that the switch is ignored for DEBOUNCE_US so the bounces do not get
+ * through. Once the window expired the SysTick ISR samples the switch again,
+ * that catches a release that happened while we were not listening.
+ *
+ * None of this runs in the main loop. So a busy pack does not delay or starve
+ * the sampling of the switch. */
+
+static volatile uint32_t t_edge;
+static volatile bool locked;
+
+static inline bool read_switch(void)
+{
+    return !(GPIOA->IDR & SWC_PIN);
+}
+
+static inline bool lock_expired(uint32_t now)
+{
+    return !locked || now - t_edge >= DEBOUNCE_US;
+}
+
+static void accept(bool level, uint32_t now)
+{
+    K_BINARY_INPUTS[0] = level;
+    t_edge = now;
+    locked = true;
+}
+
+uint32_t debounce_last_edge(void)
+{
+    return t_edge;
+}
+
+void debounce_init(void)
+{
+    K_BINARY_INPUTS[0] = read_switch();
+    t_edge = time_us();
+    locked = false;
+}
+
+#ifndef USE_ENCODER
+/**
+ * Switch interrupt handler
+ * Rising and falling edges
+ */
+void EXTI0_1_IRQHandler(void)
+{
+    EXTI->PR = SWC_PIN;
+
+    uint32_t now = time_us();
+    if (!lock_expired(now))
+        return; //Still bouncing, ignore
+
+    bool level = read_switch();
+    if (level != K_BINARY_INPUTS[0])
+        accept(level, now);
+}
+#endif
+
+void debounce_tick(void)
+{
+    /* The EXTI ISR has a higher priority than us */
+    NVIC_DisableIRQ(EXTI0_1_IRQn);
+    uint32_t now = time_us();
+    if (lock_expired(now)) {
+        locked = false;
+        bool level = read_switch();
+        /* Either it changed while we were deaf or we missed an edge */
+        if (level != K_BINARY_INPUTS[0])
+            accept(level, now);
+    }
+    NVIC_EnableIRQ(EXTI0_1_IRQn);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+/* Time in uS the switch is ignored after an accepted edge.
+ * The edge itself is reported immediately (eager debounce). */
+#ifndef DEBOUNCE_US
+#define DEBOUNCE_US 2000
+#endif
+
+void debounce_init(void);
+/* To be called from the SysTick ISR */
+void debounce_tick(void);
+/* Timestamp (time_us()) of the last accepted edge */
+uint32_t debounce_last_edge(void);
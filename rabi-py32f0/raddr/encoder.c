@@ -0,0 +1,74 @@
+#ifdef USE_ENCODER
+#include "hw.h"
+#include "gpio.h"
+#include "pins.h"
+#include "encoder.h"
+
+/* Quadrature encoder.
+ *
+ * Every edge of A or B interrupts, the ISR looks up the step from the state
+ * of both pins before and after. Nothing polls, so no step is missed however
+ * busy the pack keeps us. A bouncing contact counts back and forth and ends
+ * up where it settled. Both pins changed at once: we missed an edge, that
+ * counts as nothing.
+ *
+ * TIM1 has an encoder mode, but it does the input capture of the line and
+ * its TI1 is KEY_IN_PIN. TIM16 and the LPTIM have none.
+ *
+ * All of raddr/ is built, this only with make USE_ENCODER=y */
+
+/* [before << 2 | after], a state is A << 1 | B */
+static const int8_t steps[16] = {
+     0, +1, -1,  0,
+    -1,  0,  0, +1,
+    +1,  0,  0, -1,
+     0, -1, +1,  0,
+};
+
+static volatile uint32_t count;
+static uint8_t last;
+
+static inline uint8_t read_pins(void)
+{
+    uint32_t idr = GPIOA->IDR;
+    return !!(idr & ENC_A_PIN) << 1 | !!(idr & ENC_B_PIN);
+}
+
+static void edge(void)
+{
+    uint8_t now = read_pins();
+    count += steps[last << 2 | now];
+    last = now;
+}
+
+uint32_t encoder_count(void)
+{
+    return count;
+}
+
+void encoder_init(void)
+{
+    gpio_cfg(ENC_A_PIN | ENC_B_PIN, PIN_INPUT, PIN_PULLUP);
+    gpio_irq_both_edges(ENC_A_PIN | ENC_B_PIN);
+    last = read_pins();
+    count = 0;
+
+    /* The same priority, one never interrupts the other */
+    NVIC_SetPriority(EXTI0_1_IRQn, 2);
+    NVIC_SetPriority(EXTI4_15_IRQn, 2);
+    NVIC_EnableIRQ(EXTI0_1_IRQn);
+    NVIC_EnableIRQ(EXTI4_15_IRQn);
+}
+
+void EXTI0_1_IRQHandler(void)
+{
+    EXTI->PR = ENC_A_PIN;
+    edge();
+}
+
+void EXTI4_15_IRQHandler(void)
+{
+    EXTI->PR = ENC_B_PIN;
+    edge();
+}
+#endif
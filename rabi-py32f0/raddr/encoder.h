@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+/* Quadrature rotary encoder instead of the switch, make USE_ENCODER=y.
+ * A on the switch pin, B on PA13. That is SWDIO: flash it with the
+ * programmer connecting under reset from then on. */
+
+void encoder_init(void);
+/* Counts so far, 4 per full cycle of A and B. Wraps */
+uint32_t encoder_count(void);
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "hw.h"
+
+/* Pin setup on GPIOA, in place of HAL_GPIO_Init(). Pins are masks, as in
+ * pins.h. Only runs at startup, so one pin at a time is fine. For an
+ * alternate function gpio_af() goes first, like the HAL does. */
+
+enum pin_mode {
+    PIN_INPUT,
+    PIN_OUTPUT,
+    PIN_AF,
+    PIN_ANALOG,
+};
+
+enum pin_pull {
+    PIN_NOPULL,
+    PIN_PULLUP,
+    PIN_PULLDOWN,
+};
+
+#define PIN_SPEED_HIGH  2
+
+static inline void gpio_field(volatile uint32_t *reg, unsigned pos, unsigned width, uint32_t v)
+{
+    uint32_t mask = ((1u << width) - 1) << (pos * width);
+    *reg = (*reg & ~mask) | (v << (pos * width) & mask);
+}
+
+static inline void gpio_cfg(uint32_t pins, enum pin_mode mode, enum pin_pull pull)
+{
+    for (unsigned p = 0; p < 16; p++) {
+        if (!(pins & (1u << p)))
+            continue;
+        gpio_field(&GPIOA->OSPEEDR, p, 2, PIN_SPEED_HIGH);
+        gpio_field(&GPIOA->PUPDR, p, 2, pull);
+        gpio_field(&GPIOA->MODER, p, 2, mode);
+    }
+}
+
+static inline void gpio_af(uint32_t pins, uint32_t af, bool open_drain)
+{
+    for (unsigned p = 0; p < 16; p++) {
+        if (!(pins & (1u << p)))
+            continue;
+        gpio_field(&GPIOA->AFR[p >> 3], p & 7, 4, af);
+        gpio_field(&GPIOA->OTYPER, p, 1, open_drain);
+    }
+}
+
+/* Interrupt on both edges. EXTICR is left at its reset value, GPIOA */
+static inline void gpio_irq_both_edges(uint32_t pins)
+{
+    EXTI->RTSR |= pins;
+    EXTI->FTSR |= pins;
+    EXTI->IMR |= pins;
+}
@@ -0,0 +1,154 @@
+#ifdef USE_HALL
+#include <stdbool.h>
+#include <py32f0xx_hal.h>
+#include <arm_math.h>
+#include "wolf.h"
+#include "pins.h"
+#include "hall.h"
+
+/* Analog hall-effect key.
+ *
+ * The SysTick ISR reads the conversion it started the tick before and starts
+ * the next one, so we sample at 1kHz without waiting on the ADC. The sample
+ * goes through a q15 biquad from CMSIS-DSP, a 2nd order Butterworth low pass
+ * at 100Hz. Latency a couple of ms, the noise of the sensor is gone.
+ *
+ * Rapid trigger runs right here: the key presses when it went HALL_RT_DOWN
+ * further than where it turned around, and releases when it came HALL_RT_UP
+ * back from the bottom. Only the outcome and a coarse travel go in the frame,
+ * the pack never sees the samples.
+ *
+ * All of raddr/ is built, this only with make USE_HALL=y */
+
+#define TRAVEL_SHIFT    (15 - (K - 1))
+
+/* {b0, 0, b1, b2, -a1, -a2} / 2 with postShift 1, fc 100Hz at fs 1kHz */
+static const q15_t coeffs[6] = {1105, 0, 2210, 1105, 18727, -6763};
+static q15_t state[4];
+static arm_biquad_casd_df1_inst_q15 biquad;
+
+static ADC_HandleTypeDef adc;
+
+static q15_t rest;
+static int32_t span = HALL_SPAN_MIN;
+static unsigned rest_ms;
+static int32_t rest_sum;
+
+static bool pressed;
+static q15_t turn;                      //top since release, bottom since press
+static volatile uint16_t reported;
+
+static q15_t filter(uint32_t sample)
+{
+    q15_t in = sample << 2, out;
+
+    arm_biquad_cascade_df1_q15(&biquad, &in, &out, 1);
+    return out;
+}
+
+static q15_t travel(q15_t y)
+{
+    int32_t d = y - rest;
+
+    //Which way the magnet pushes depends on how it was mounted
+    if (d < 0)
+        d = -d;
+    if (d > span)
+        span = d;
+    return (d << 15) / (span + 1);
+}
+
+static void rapid_trigger(q15_t t)
+{
+    if (!pressed) {
+        if (t < turn)
+            turn = t;
+        if (t >= HALL_ACTUATE && t - turn >= HALL_RT_DOWN) {
+            pressed = true;
+            turn = t;
+        }
+    } else {
+        if (t > turn)
+            turn = t;
+        if (t < HALL_ACTUATE || turn - t >= HALL_RT_UP) {
+            pressed = false;
+            turn = t;
+        }
+    }
+    K_BINARY_INPUTS[0] = pressed;
+}
+
+static void report(q15_t t)
+{
+    int32_t lo = (int32_t)reported << TRAVEL_SHIFT;
+    int32_t hi = lo + (1 << TRAVEL_SHIFT);
+
+    if (t < lo - HALL_DEADBAND || t >= hi + HALL_DEADBAND)
+        reported = t >> TRAVEL_SHIFT;
+}
+
+uint16_t hall_travel(void)
+{
+    return reported;
+}
+
+void hall_init(void)
+{
+    ADC_ChannelConfTypeDef ch = {
+        .Channel = ADC_CHANNEL_1,       //PA1, SWC_PIN
+        .Rank = ADC_RANK_CHANNEL_NUMBER,
+        .SamplingTime = ADC_SAMPLETIME_41CYCLES_5,
+    };
+    GPIO_InitTypeDef pin = {
+        .Pin = SWC_PIN,
+        .Mode = GPIO_MODE_ANALOG,
+        .Pull = GPIO_NOPULL,
+    };
+
+    HAL_GPIO_Init(GPIOA, &pin);
+    __HAL_RCC_ADC_CLK_ENABLE();
+    adc.Instance = ADC1;
+    adc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    adc.Init.Resolution = ADC_RESOLUTION_12B;
+    adc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    adc.Init.ScanConvMode = ADC_SCAN_DIRECTION_FORWARD;
+    adc.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+    adc.Init.LowPowerAutoWait = DISABLE;
+    adc.Init.ContinuousConvMode = DISABLE;
+    adc.Init.DiscontinuousConvMode = DISABLE;
+    adc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    adc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+    HAL_ADC_Init(&adc);
+    HAL_ADC_Calibration_Start(&adc);
+    HAL_ADC_ConfigChannel(&adc, &ch);
+
+    arm_biquad_cascade_df1_init_q15(&biquad, 1, coeffs, state, 1);
+    rest_ms = rest_sum = 0;
+    pressed = false;
+    turn = 0;
+    reported = 0;
+    K_BINARY_INPUTS[0] = false;
+    HAL_ADC_Start(&adc);
+}
+
+void hall_tick(void)
+{
+    if (!(ADC1->ISR & ADC_ISR_EOC))
+        return;
+    q15_t y = filter(ADC1->DR);
+    ADC1->CR |= ADC_CR_ADSTART;
+
+    //Let the filter settle, then average the rest position
+    if (rest_ms < 2 * HALL_REST_MS) {
+        if (rest_ms++ >= HALL_REST_MS)
+            rest_sum += y;
+        if (rest_ms == 2 * HALL_REST_MS)
+            rest = rest_sum / HALL_REST_MS;
+        return;
+    }
+
+    q15_t t = travel(y);
+    rapid_trigger(t);
+    report(t);
+}
+#endif
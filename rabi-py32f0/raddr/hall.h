@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+
+/* Analog hall-effect key on the switch pin, make USE_HALL=y.
+ *
+ * Travel is in q15: 0 at rest, 0x7FFF all the way down. The thresholds of
+ * rapid trigger are in the same units. */
+#define HALL_ACTUATE    0x0CCD  //10%, never pressed above this
+#define HALL_RT_DOWN    0x0666  //5% down from the top since release presses
+#define HALL_RT_UP      0x0666  //5% up from the bottom since press releases
+/* The reported travel only moves when it leaves its step by this much, so
+ * noise does not change the frame every poll */
+#define HALL_DEADBAND   0x0200
+/* Full travel is the largest swing seen from rest, at least this much. In
+ * the units of the filter, ADC counts << 2 */
+#define HALL_SPAN_MIN   (200 << 2)
+/* Samples averaged for the rest position at startup, do not touch the key */
+#define HALL_REST_MS    64
+
+void hall_init(void);
+/* To be called from the SysTick ISR, samples at 1kHz */
+void hall_tick(void);
+/* The travel reported in the frame, top bits of the q15 with a deadband */
+uint16_t hall_travel(void);
@@ -0,0 +1,20 @@
+#pragma once
+/* The device, on the HAL or with make USE_LL_LIB=y on LL and registers
+ * alone. raddr/ itself only touches registers, the HAL is left for the ADC
+ * of hall.c. */
+#ifdef USE_FULL_LL_DRIVER
+#include "py32f0xx.h"
+#include "py32f0xx_ll_bus.h"
+#include "py32f0xx_ll_rcc.h"
+#include "py32f0xx_ll_system.h"
+#include "py32f0xx_ll_utils.h"
+#include "py32f0xx_ll_cortex.h"
+
+/* As in py32f0xx_hal_conf.h */
+#define PRIORITY_HIGHEST        0
+#define PRIORITY_HIGH           1
+#define PRIORITY_LOW            2
+#define PRIORITY_LOWEST         3
+#else
+#include <py32f0xx_hal.h>
+#endif
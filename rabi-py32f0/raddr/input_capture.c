@@ -1,8 +1,9 @@
 #include <stdio.h>
 #include <stdbool.h>
-#include <py32f0xx_hal.h>
+#include "hw.h"
 #include "wolf.h"
 #include "input_capture.h"
+#include "trim.h"
 
 //For 24Mhz this is 41ns
 #define INPUT_TIMER_ACTUAL_TIME_PER_TICK (1.0 * INPUT_TIMER_DIVIDER / HSI_VALUE)
@@ -54,9 +55,9 @@ uint32_t received_bits_read(void)
     fifo.read = (idx + 1) % FIFO_SIZE;
 
     /* Updating size must be atomic! Against TIM1 ISR(s) */
-    HAL_NVIC_DisableIRQ(TIM1_CC_IRQn);
+    NVIC_DisableIRQ(TIM1_CC_IRQn);
     fifo.size--;
-    HAL_NVIC_EnableIRQ(TIM1_CC_IRQn);
+    NVIC_EnableIRQ(TIM1_CC_IRQn);
 
     return d;
 }
@@ -131,6 +132,10 @@ void TIM1_CC_IRQHandler(void)
     tmo |= status << 16;
 #endif
     fifo_write(tmo);
+#ifdef USE_HSI_TRIM
+    /* Reset on the rising edge of this bit, that was the length of the last */
+    trim_period(TIM1->CCR1);
+#endif
 
 #if 0 && defined(RADDR_INPUT_DEBUG)
     /* Printing in an ISR is very bad idea! */
@@ -161,7 +166,7 @@ void raddr_input_capture_init(void)
      * */
 
     /* Enable the clock towards TIM1 */
-    __HAL_RCC_TIM1_CLK_ENABLE();
+    SET_BIT(RCC->APBENR2, RCC_APBENR2_TIM1EN);
 
     //TIM1->CCER = 0; //Disable all comparators
 
@@ -208,8 +213,7 @@ void raddr_input_capture_init(void)
 
     /* Setup general timer config */
     tmp = 0;
-    tmp |= TIM_COUNTERMODE_UP; // == 0
-    tmp |= TIM_CLOCKDIVISION_DIV1; // == 00
+    //Counting up, no clock division: both 0
     /* Disable update on event */
     tmp |= TIM_CR1_UDIS;
     /* Enable the timer. */
@@ -217,8 +221,8 @@ void raddr_input_capture_init(void)
     TIM1->CR1 = tmp;
 
     /* We need to be the next to highest priority */
-    HAL_NVIC_SetPriority(TIM1_CC_IRQn, PRIORITY_HIGH, 0);
-    HAL_NVIC_EnableIRQ(TIM1_CC_IRQn);
+    NVIC_SetPriority(TIM1_CC_IRQn, PRIORITY_HIGH);
+    NVIC_EnableIRQ(TIM1_CC_IRQn);
 
 #if defined(RADDR_INPUT_DEBUG)
     printf("Input divider %ld %ld"
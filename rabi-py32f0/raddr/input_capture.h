@@ -1,6 +1,6 @@
 #pragma once
 
-#include <py32f0xx_hal.h>
+#include "hw.h"
 /* Run at maximum speed */
 #define INPUT_TIMER_DESIRED_BASE_TICK     (1.0/HSI_VALUE)
 #define INPUT_TIMER_DIVIDER         ((uint32_t)(HSI_VALUE * INPUT_TIMER_DESIRED_BASE_TICK))
@@ -1,11 +1,18 @@
-#include <py32f0xx_hal.h>
+#include "hw.h"
 #include "clk_config.h"
+#include "gpio.h"
 
 #include "uid.h"
 #include "output_timer.h"
 #include "input_capture.h"
 #include "wolf.h"
 #include "pack.h"
+#include "pins.h"
+#include "debounce.h"
+#include "hall.h"
+#include "encoder.h"
+#include "trim.h"
+#include "boot.h"
 
 /*  A wolf is:
  *  Pin     Port(s)         PCB function    SPI1        I2C     UART1       TIM1        Alternate functions
@@ -19,63 +26,83 @@
  *  Pin 1   VCC             VCC             -
  * */
 
-#define SWC_PIN     GPIO_PIN_1
-#define KEY_IN_PIN  GPIO_PIN_3
-#define KEY_OUT_PIN GPIO_PIN_4
-
 /**
  * These need to be implemented by us, They are used
  * by the pack.c code
  */
 bool K_BINARY_INPUTS[K] = {0};
 
+void update_input(void)
+{
+#if ENCODER
+    /* The count wraps, the Akela only needs the difference */
+    uint32_t count = encoder_count();
+    for (int k = K - 1; k >= 0; k--) {
+        K_BINARY_INPUTS[k] = count & 1;
+        count >>= 1;
+    }
+#elif K > 1 && HALL
+    /* The level is kept up to date by rapid trigger, the rest is travel */
+    uint32_t travel = hall_travel();
+    for (int k = K - 1; k > 0; k--) {
+        K_BINARY_INPUTS[k] = travel & 1;
+        travel >>= 1;
+    }
+#elif K > 1
+    /* K_BINARY_INPUTS[0] is kept up to date by the debouncer. The rest
+     * of the frame is the age of that last edge. */
+    uint32_t age = (time_us() - debounce_last_edge()) >> AGE_SHIFT;
+    if (age > AGE_MAX)
+        age = AGE_MAX;
+    for (int k = K - 1; k > 0; k--) {
+        K_BINARY_INPUTS[k] = age & 1;
+        age >>= 1;
+    }
+#endif
+}
 
+/* The bootloader takes over after a software reset, see boot/main.c */
+static bool update_requested;
 
-static void cfg_pin(uint32_t pin, uint32_t mode, uint32_t pull)
+void bulk_message(const struct bulk *b)
 {
-    GPIO_InitTypeDef pin_cfg;
-
-    pin_cfg.Pin   = pin;
-    pin_cfg.Mode  = mode;
-    pin_cfg.Pull  = pull;
-    pin_cfg.Speed = GPIO_SPEED_FREQ_HIGH;
-    //MEGA HACK SMELLY CODE.
-    //We only specify mode = Alternate Function for one pin. and so this works.
-    //Do not do try this at home.
-    pin_cfg.Alternate = GPIO_AF13_TIM1;
-    HAL_GPIO_Init(GPIOA, &pin_cfg);
+    if (b->hdr == BULK_UPDATE)
+        update_requested = true;
+}
+
+uint32_t bulk_answer(const struct bulk *b)
+{
+    if (b->hdr == BULK_UID)
+        return uid_word(b->data[0]);
+    return boot_info_answer();
 }
 
 static void cfg_gpio(void)
 {
-    __HAL_RCC_GPIOA_CLK_ENABLE();
-    cfg_pin(SWC_PIN,     GPIO_MODE_IT_RISING_FALLING, GPIO_PULLUP);
-    cfg_pin(KEY_IN_PIN,  GPIO_MODE_AF_OD, GPIO_PULLUP);
-    cfg_pin(KEY_OUT_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+    SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOAEN);
+    gpio_af(KEY_IN_PIN, KEY_IN_AF, true);
+    gpio_cfg(KEY_IN_PIN,  PIN_AF, PIN_PULLUP);
+    gpio_cfg(KEY_OUT_PIN, PIN_OUTPUT, PIN_NOPULL);
+#if !defined USE_HALL && !defined USE_ENCODER
+    gpio_cfg(SWC_PIN,     PIN_INPUT, PIN_PULLUP);
+    gpio_irq_both_edges(SWC_PIN);
 
     /* EXTI interrupt init*/
-    HAL_NVIC_SetPriority(EXTI0_1_IRQn, 2, 0);
-    HAL_NVIC_EnableIRQ(EXTI0_1_IRQn);
-
-}
+    NVIC_SetPriority(EXTI0_1_IRQn, 2);
+    NVIC_EnableIRQ(EXTI0_1_IRQn);
+#endif
 
-/**
- * Switch interrupt handler
- * Rising and falling edges
- */
-void EXTI0_1_IRQHandler(void)
-{
-    //I think this causes bounce issues
-    K_BINARY_INPUTS[0] = !HAL_GPIO_ReadPin(GPIOA, SWC_PIN);
-    __HAL_GPIO_EXTI_CLEAR_IT(SWC_PIN);
 }
 
 int main(void)
 {
-    /* Setup clock BEFORE HAL_Init.
+    /* Setup clock BEFORE the tick.
      * And before running anything else */
     BSP_HSI_24MHzClockConfig();
-    HAL_Init();
+    tick_init();
+#ifdef USE_HSI_TRIM
+    trim_init();
+#endif
 #if defined USE_SEMIHOSTING
     {
         //This 'magic' function needs to be called.
@@ -90,8 +117,13 @@ int main(void)
     cfg_gpio();
     raddr_output_init();
     raddr_input_capture_init();
-
-    uint32_t t_bounce = 0;
+#if defined USE_HALL
+    hall_init();
+#elif defined USE_ENCODER
+    encoder_init();
+#else
+    debounce_init();
+#endif
 
 #ifdef WOUTER_DEBUG
     /* Loop that assumes input is connected to the output and then
@@ -105,7 +137,7 @@ int main(void)
     const int bits_to_send = 3;
 
     while (1) {
-        uint32_t now = HAL_GetTick();
+        uint32_t now = time_ms();
         /* Do test once every second */
         if (now - t_last_tx > 1000) {
             //uint32_t tmo = us_to_timer_tick(T1H);
@@ -151,18 +183,13 @@ int main(void)
 
     /* Main loop */
     while (1) {
-        uint32_t now = HAL_GetTick();
-
-        if (!receive_bits_available()) {
-            // if no data, take the time to update inputs
-            bool input = !HAL_GPIO_ReadPin(GPIOA, SWC_PIN);
-            // if input changed only set it when done bouncing
-            if (input^K_BINARY_INPUTS[0] && t_bounce < now) {
-                K_BINARY_INPUTS[0] = input;
-                t_bounce = now + 2; // only accept change in 2ms
-            }
+        /* Once the message went out entirely */
+        if (update_requested && raddr_output_idle())
+            NVIC_SystemReset();
+
+        /* The input is handled by its ISRs, all we do is bark */
+        if (!receive_bits_available())
             continue;
-        }
 
         int bit = receive_bit();
 
@@ -177,6 +204,7 @@ int main(void)
                 //printf("Received RESET!\r\n");
 #endif
                 join_cry(!GROWL, CRY_RESET);
+                raddr_output_flush();
                 raddr_output_schedule(1, us_to_timer_tick(TRESET));
                 raddr_output_schedule(0, us_to_timer_tick(TRESET / 2));
                 break;
@@ -1,11 +1,9 @@
 #include <stdio.h>
 #include <stdbool.h>
-#include <py32f0xx_hal.h>
+#include "hw.h"
 #include "wolf.h"
 #include "output_timer.h"
-//
-//TODO get these from a header file
-#define KEY_DATA_OUT_PIN     GPIO_PIN_4
+#include "pins.h"
 
 //We need to pick the tick_per_clock as low as reasonably possible.
 //But is also defines the upper time:
@@ -15,9 +13,12 @@
 //  8M  /3            125ns     8192ns
 //  1M  /24          1000ns     65535ms
 
-#define FIFO_SIZE 16 //Must be a power of 2 and at least capable of handling a full K message
+#define FIFO_SIZE 128 //Must be a power of 2 and at least capable of handling a full K message
 
-_Static_assert(FIFO_SIZE > 2*K, "FIFO_SIZE needs to be able to contain at least a full K of barks");
+/* A howl is bulk scheduled: BARK, the frame and the HOWL. 2 entries per bit.
+ * So is the answer to a query: marker, answer and EOT. */
+_Static_assert(FIFO_SIZE >= 2*(FRAME_LEN + 2 + DELTA), "FIFO_SIZE needs to be able to contain at least a full frame of barks");
+_Static_assert(FIFO_SIZE >= 2*(32 + 2) + 4, "FIFO_SIZE needs to be able to contain the answer to a query");
 _Static_assert((FIFO_SIZE & (FIFO_SIZE - 1)) == 0 , "FIFO_SIZE needs to be a power of 2 to make access FAST");
 
 /* The length the pulse is actually larger the specified.
@@ -87,6 +88,23 @@ void raddr_output_bulk_end(void) {
     }
 }
 
+/* Drop everything not yet on the wire. The symbol being sent finishes.
+ * A reset uses this to get through right away, instead of waiting behind
+ * a queue of garbage that is going to be thrown away anyway. */
+void raddr_output_flush(void)
+{
+    NVIC_DisableIRQ(TIM16_IRQn);
+    fifo.size = 0;
+    fifo.read = fifo.write;
+    NVIC_EnableIRQ(TIM16_IRQn);
+}
+
+/* Everything is on the wire. The ISR switches itself off when done */
+bool raddr_output_idle(void)
+{
+    return !(TIM16->DIER & TIM_DIER_UIE);
+}
+
 /* Supports a single writer only!
  *  A few things to note here:
  *
@@ -162,7 +180,7 @@ void TIM16_IRQHandler(void)
     /* BSRR => Bit Set Reset Register.
      * Lower 16 bit: Write 1 to set I/O
      * Upper 16 bit: Write 1 to clear I/O */
-    GPIOA->BSRR = bit ? KEY_DATA_OUT_PIN : KEY_DATA_OUT_PIN << 16;
+    GPIOA->BSRR = bit ? KEY_OUT_PIN : KEY_OUT_PIN << 16;
 
     /* Last part is writing the timer registers */
 
@@ -196,7 +214,7 @@ void TIM16_IRQHandler(void)
     TIM16->EGR = TIM_EGR_UG;
 
     /* Acknowledge the interrupt */
-    TIM16->SR = ~TIM_IT_UPDATE;
+    TIM16->SR = ~TIM_SR_UIF;
 }
 
 void raddr_output_init(void)
@@ -204,7 +222,7 @@ void raddr_output_init(void)
     uint32_t tmpcr1;
 
     /* First enable the clocking towards TIM16 */
-    __HAL_RCC_TIM16_CLK_ENABLE();
+    SET_BIT(RCC->APBENR2, RCC_APBENR2_TIM16EN);
 
     /* Set the Autoreload value to max */
     //TIM16->ARR = ~0;
@@ -214,18 +232,17 @@ void raddr_output_init(void)
 
     /* Setup timer for simple upcounting (no repeat, not autoreload etc) */
     tmpcr1 = 0;
-    tmpcr1 |= TIM_COUNTERMODE_UP; //0
-    tmpcr1 |= TIM_CLOCKDIVISION_DIV1; //0
+    //Counting up, no clock division: both 0
     /* Enable the timer. */
     tmpcr1 |= TIM_CR1_CEN;
 
     TIM16->CR1 = tmpcr1;
 
     /* We need to be the highest priority, to ensure rock solid jitter free output! */
-    HAL_NVIC_SetPriority(TIM16_IRQn, PRIORITY_HIGHEST, 0);
+    NVIC_SetPriority(TIM16_IRQn, PRIORITY_HIGHEST);
 
     /* Enable our interrupt */
-    HAL_NVIC_EnableIRQ(TIM16_IRQn);
+    NVIC_EnableIRQ(TIM16_IRQn);
 
 #if defined(RADDR_OUTPUT_DEBUG)
     printf("HSI Clock: %ld, divider %ld\r\n", HSI_VALUE, TIMER_DIVIDER);
@@ -1,7 +1,8 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
-#include "py32f0xx_hal.h"
+#include "hw.h"
+#include "clk_config.h"
 
 void raddr_output_init(void);
 
@@ -31,10 +32,14 @@ void raddr_output_bulk_begin(void);
 void raddr_output_bulk_schedule(bool bit, uint16_t tmo);
 void raddr_output_bulk_end(void);
 
+void raddr_output_flush(void);
+bool raddr_output_idle(void);
+
 static inline void raddr_output_debug(void)
 {
 #if defined(RADDR_OUTPUT_DEBUG)
-    HAL_Delay(1000);
+    for (uint32_t t0 = time_ms(); time_ms() - t0 < 1000;)
+        ;
     uint16_t t = us_to_timer_tick(10);
     for (int i = 0; i < 16/2; i++) //FIFO_SIZE / 2
     {
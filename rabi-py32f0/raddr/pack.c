@@ -6,67 +6,97 @@
 
 #include "wolf.h"
 #include "pack.h"
+#include "canine.h"
 
 #define DBG 0
 
+static struct bulk bulk;
+
+/* With DELTA, the frame we sent last. A reset forgets it */
+static bool reported[K];
+static bool reported_valid;
+
+/* The frame in K_BINARY_INPUTS, unless DELTA and the Akela has it */
+static void howl_frame(void)
+{
+    update_input();
+    if (DELTA) {
+        bool same = reported_valid;
+        for (int k = 0; k < K; k++) {
+            same &= reported[k] == K_BINARY_INPUTS[k];
+            reported[k] = K_BINARY_INPUTS[k];
+        }
+        reported_valid = true;
+        bark_bulk(!same);
+        if (same)
+            return;
+    }
+    int parity = 1;
+    for (int k=0; k<K; k++) {
+        bark_bulk(K_BINARY_INPUTS[k]);
+        parity ^= K_BINARY_INPUTS[k];
+    }
+    bark_bulk(parity);
+}
+
+/* Our answer to a query, the marker in front and the EOT that was ours
+ * to pass on after it. Up to 34 bits, bulk schedules them in one go. */
+static void answer(void)
+{
+    unsigned n = bulk_answer_bits(bulk.hdr);
+    uint32_t a = bulk_answer(&bulk);
+
+    raddr_output_bulk_begin();
+    bark_bulk(0);
+    while (n--)
+        bark_bulk((a >> n) & 1);
+    bark_bulk(1);
+    raddr_output_bulk_end();
+}
+
 void join_cry(int bit, enum CryCommand cmd)
 {
-    static int state = S_REST;
-    static int bark_i = K;
+    static uint8_t state = CR_REST;
 
     if (cmd == CRY_RESET) {
-        state = S_REST;
+        state = CR_REST;
+        bulk_reset(&bulk);
+        reported_valid = false;
         return;
     }
 
-    switch (state) {
-        case S_REST:
-            if (DBG) printf("REST\r\n");
-            if (bit == GROWL) { //growl
-                if (DBG) printf("goto ALERT\r\n");
-                state = S_ALERT;
-                bark_full(GROWL); //wake up next with growl
-            } else {
-                /* a BARK makes no sense here. Therefor just absorb it */
-            }
-            break; //Wait for next bit
-        case S_ALERT:
-            if (DBG) printf("ALERT\r\n");
-            if (bit != HOWL) {
-                bark_full(BARK); //Yelp, so next will copy next frame
-                if (DBG) printf("goto BARK\r\n");
-                state = S_BARK; //
-                break; //Wait for next bit
-            }
+    struct canine_step step = canine_rabi[state][bit];
+    if (DBG) printf("%d -> %d\r\n", state, step.next);
+    state = step.next;
+
+    switch (step.action) {
+        case CR_COPY:
+            bark_full(bit); //Pass it on, growls, barks and frames alike
+            break;
+        case CR_HOWL:
+            //Our turn. Tell the next to listen for a frame, then howl
             raddr_output_bulk_begin();
             bark_bulk(BARK);
-            //update_input();
-            for (int k=0; k<K; k++) {
-                bark_bulk(K_BINARY_INPUTS[k]);
-            }
-            if (DBG) printf("goto HOWL\r\n");
-            state = S_HOWL; // not really needed
-            /* FALL-THROUGH */
-        /* Since we do not have to wait for a bit we do a fall through here.
-         * It *is* an actual state in the finite automata sense. */
-        case S_HOWL:
-            if (DBG) printf("HOWL\r\n");
-            //Maybe include parity bit?
-            bark_bulk(HOWL); //Howl, so next will also go to S_HOWL
-            if (DBG) printf("goto REST\r\n");
-            state = S_REST; //we are the last. Get some rest.
+            howl_frame();
+            bark_bulk(HOWL);
             raddr_output_bulk_end();
-            break; //Wait for next bit
-        case S_BARK:
-            if (DBG) printf("BARK\r\n");
-            bark_full(bit); //Copy input to output
-            if (!--bark_i) {
-                if (DBG) printf("goto ALERT\r\n");
-                state = S_ALERT;
-                bark_i = K;
-                //maybe check parity? Go to S_REST on parity fail?
+            break;
+        case CR_BULK:
+            switch (bulk_step(&bulk, bit)) {
+                case BULK_COPY:
+                    bark_full(bit);
+                    return;
+                case BULK_END:
+                    bark_full(bit);
+                    if (bulk.ok)
+                        bulk_message(&bulk);
+                    break;
+                case BULK_ANSWER:
+                    answer();
+                    bulk_message(&bulk);
+                    break;
             }
-            break; //Wait for next bit
+            state = CR_REST;
+            break;
     }
 }
-
@@ -1,5 +1,7 @@
 #ifndef PACK_H
 #define PACK_H
+#include "bulk.h"
+
 enum CryCommand  {
     CRY_OKAY,
     CRY_RESET,
@@ -8,5 +10,11 @@ enum CryCommand  {
 void join_cry(int bit, enum CryCommand cmd);
 void rally_pack();
 
-#endif
+/* To be implemented by the user of pack.c. An extended message we know
+ * went past, complete. Called before its EOT is on the wire, anything
+ * slow has to wait until the output is idle. */
+extern void bulk_message(const struct bulk *b);
+/* Our answer to the query in b, bulk_answer_bits() of it, MSB first */
+extern uint32_t bulk_answer(const struct bulk *b);
 
+#endif
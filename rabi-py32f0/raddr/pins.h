@@ -0,0 +1,13 @@
+#pragma once
+#include "hw.h"
+
+/* See main.c for the full pinout of a wolf */
+#define SWC_PIN     (1u << 1)
+#define KEY_IN_PIN  (1u << 3)
+#define KEY_OUT_PIN (1u << 4)
+/* Alternate function of KEY_IN_PIN: TIM1_CH1 */
+#define KEY_IN_AF   13
+
+/* make USE_ENCODER=y, see encoder.h */
+#define ENC_A_PIN   SWC_PIN
+#define ENC_B_PIN   (1u << 13)
@@ -37,7 +37,9 @@
   */
 #define HAL_MODULE_ENABLED
 #define HAL_RCC_MODULE_ENABLED
-/* #define HAL_ADC_MODULE_ENABLED */
+#ifdef USE_HALL
+#define HAL_ADC_MODULE_ENABLED      /* the hall-effect key, see hall.h */
+#endif
 /* #define HAL_CRC_MODULE_ENABLED */
 /* #define HAL_COMP_MODULE_ENABLED */
 #define HAL_FLASH_MODULE_ENABLED
@@ -21,10 +21,14 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
-#include "py32f0xx_hal.h"
+#include "hw.h"
 #include "py32f0xx_it.h"
 
 /* Private includes ----------------------------------------------------------*/
+#include "clk_config.h"
+#include "debounce.h"
+#include "hall.h"
+#include "trim.h"
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
@@ -72,7 +76,15 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-  HAL_IncTick();
+  tick_inc();
+#if defined USE_HALL
+  hall_tick();
+#elif !defined USE_ENCODER
+  debounce_tick();
+#endif
+#ifdef USE_HSI_TRIM
+  trim_tick();
+#endif
 }
 
 /******************************************************************************/
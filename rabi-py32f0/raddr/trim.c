@@ -0,0 +1,66 @@
+#include "hw.h"
+#include "wolf.h"
+#include "input_capture.h"
+#include "trim.h"
+
+/* HSI trim against the upstream bit rate.
+ *
+ * TIM1 resets on every rising edge of the input and CCR1 captures where it
+ * was: the length of the bit before, in our ticks. Back to back bits are
+ * TTOTAL apart by the clock of whoever sent them. The input capture ISR hands
+ * those to us, anything else (the first bit of a cry, a reset) is too far off
+ * and ignored.
+ *
+ * The SysTick ISR looks at the sum every TRIM_BITS bits. Too many ticks, we
+ * run fast: one step down. Too few: one step up. Within half a tick per bit
+ * it is left alone, so it does not hunt. */
+
+#define T_BIT_TICKS     ((uint32_t)TTOTAL * (HSI_VALUE / 1000000) / INPUT_TIMER_DIVIDER)
+#define T_BIT_WINDOW    (T_BIT_TICKS / 16)
+
+static volatile uint32_t sum, bits;
+static int factory, trim;
+
+static void set_trim(int t)
+{
+    trim = t;
+    MODIFY_REG(RCC->ICSCR, RCC_ICSCR_HSI_TRIM, (uint32_t)t << RCC_ICSCR_HSI_TRIM_Pos);
+}
+
+void trim_init(void)
+{
+    factory = trim = (RCC->ICSCR & RCC_ICSCR_HSI_TRIM) >> RCC_ICSCR_HSI_TRIM_Pos;
+    sum = bits = 0;
+}
+
+int trim_offset(void)
+{
+    return trim - factory;
+}
+
+void trim_period(uint32_t ticks)
+{
+    if (ticks - (T_BIT_TICKS - T_BIT_WINDOW) > 2 * T_BIT_WINDOW)
+        return;
+    sum += ticks;
+    bits++;
+}
+
+void trim_tick(void)
+{
+    if (bits < TRIM_BITS)
+        return;
+
+    /* Against the input capture ISR */
+    NVIC_DisableIRQ(TIM1_CC_IRQn);
+    uint32_t s = sum, n = bits;
+    sum = bits = 0;
+    NVIC_EnableIRQ(TIM1_CC_IRQn);
+
+    int32_t error = s - n * T_BIT_TICKS;
+    if (2 * error > (int32_t)n && trim > factory - TRIM_RANGE && trim > 0)
+        set_trim(trim - 1);
+    else if (2 * error < -(int32_t)n && trim < factory + TRIM_RANGE &&
+            trim < (int)(RCC_ICSCR_HSI_TRIM >> RCC_ICSCR_HSI_TRIM_Pos))
+        set_trim(trim + 1);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+/* Trims the HSI to the bits coming in, with make USE_HSI_TRIM=y.
+ *
+ * Every bit upstream sends is TTOTAL long by its clock, and its clock was
+ * trimmed to the one before it, up to the crystal of the Akela. */
+
+/* Bits averaged before the trim takes a step */
+#define TRIM_BITS       256
+/* Steps at most away from the factory trim */
+#define TRIM_RANGE      64
+
+/* Right after the clock is set up */
+void trim_init(void);
+/* From the input capture ISR: timer ticks of the bit before */
+void trim_period(uint32_t ticks);
+/* To be called from the SysTick ISR */
+void trim_tick(void);
+/* Steps away from the factory trim */
+int trim_offset(void);
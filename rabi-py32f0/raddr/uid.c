@@ -1,7 +1,8 @@
 #include <stdint.h>
 #include <stdio.h>
-#include <py32f0xx_hal.h>
+#include "hw.h"
 #include "uid.h"
+#include "bulk.h"
 
 #define ARRAY_SIZE(a)  (sizeof(a)/sizeof(a[0]))
 
@@ -31,6 +32,13 @@ union unique_id {
 
 #define UID ((union unique_id*)UID_BASE)
 
+uint32_t uid_word(unsigned w)
+{
+    if (w < UID_WORDS)
+        return UID->raw_int[w];
+    return w == UID_HASH ? uid_hash(UID->raw_int) : 0;
+}
+
 void uid_print(void)
 {
 #if defined(USE_SEMIHOSTING)
@@ -1,3 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 void uid_print(void);
+/* Word w of the unique ID, or UID_HASH for uid_hash() of it */
+uint32_t uid_word(unsigned w);
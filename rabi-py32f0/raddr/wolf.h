@@ -15,6 +15,40 @@
 
 #define K 1
 
+/* With K > 1 a frame holds the switch level followed by the K-1 bits age of
+ * its last edge, MSB first. The age is in units of 2^AGE_SHIFT uS and
+ * saturates. The Akela uses it to order and timestamp key events. */
+#define AGE_SHIFT 5
+#define AGE_MAX   ((1u << (K - 1)) - 1)
+
+/* An analog hall-effect key instead of the switch, make USE_HALL=y. The
+ * level is decided by rapid trigger and the K-1 bits are the travel of the
+ * key instead of the age, see hall.h. Must match the Akela. */
+#ifdef USE_HALL
+#define HALL 1
+#else
+#define HALL 0
+#endif
+
+/* A quadrature encoder instead of the switch, make USE_ENCODER=y. All K
+ * bits are its count modulo 2^K, MSB first. The Akela takes the difference
+ * with the count of the cry before, see encoder.h. */
+#ifdef USE_ENCODER
+#define ENCODER 1
+#else
+#define ENCODER 0
+#endif
+_Static_assert(!ENCODER || K > 1, "An encoder needs K > 1");
+_Static_assert(!(ENCODER && HALL), "One input per rabi");
+
+/* Delta polls: 1 in front of our frame, or only a 0 when it is the same as
+ * the one we sent last since the reset. Must match the Akela. */
+#define DELTA 0
+
+/* Every frame ends with a parity bit, making the number of ones in the
+ * frame odd. Only the Akela checks it, the pack just copies it along. */
+#define FRAME_LEN (K + 1)
+
 // Start of transmission
 // Will be followed by either a HOWL or a BARK
 #define GROWL 1
@@ -24,14 +58,9 @@
 // Will be followed by a dataframe of K bits
 #define BARK (!HOWL)
 
-enum states {
-    S_REST,       //do nothing
-    S_ALERT,      //listen for howl
-    S_HOWL,       //transmit frame
-    S_BARK        //copy frame
-};
-
 extern bool K_BINARY_INPUTS[K];
+/* Called right before K_BINARY_INPUTS is howled */
+extern void update_input(void);
 
 /**
  * bark a full bit. This is useful for sending a single bit
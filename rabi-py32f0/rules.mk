@@ -79,6 +79,11 @@ ifeq "$(IS_GCC_ABOVE_12)" "1"
     TGT_LDFLAGS += -Wl,--no-warn-rwx-segments
 endif
 
+ifeq ($(LTO),y)
+TGT_CFLAGS	+= -flto
+TGT_LDFLAGS	+= -flto
+endif
+
 ifeq ($(ENABLE_PRINTF_FLOAT),y)
 TGT_LDFLAGS	+= -u _printf_float
 endif
@@ -152,7 +157,7 @@ flash: $(BDIR)/$(PROJECT).elf
 ifeq ($(FLASH_PROGRM),jlink)
 	$(JLINKEXE) -device $(JLINK_DEVICE) -if swd -speed 4000 -JLinkScriptFile $(TOP)/Misc/jlink-script -CommanderScript $(TOP)/Misc/jlink-command
 else ifeq ($(FLASH_PROGRM),pyocd)
-	$(PYOCD_EXE) erase -t $(PYOCD_DEVICE) --chip --config $(TOP)/Misc/pyocd.yaml
+	$(PYOCD_EXE) erase -t $(PYOCD_DEVICE) $(FLASH_ERASE) --config $(TOP)/Misc/pyocd.yaml
 	$(PYOCD_EXE) load $< -t $(PYOCD_DEVICE) --config $(TOP)/Misc/pyocd.yaml
 else
 	@echo "FLASH_PROGRM is invalid\n"
@@ -0,0 +1,20 @@
+#ifndef AKELA_CONFIG_H
+#define AKELA_CONFIG_H
+
+/* The pack the tools expect. Override K and DELTA to match the rabies,
+ * e.g. make K=8 DELTA=1 */
+#ifndef K
+#define K 1
+#endif
+#define W 128           /* rabies beyond this are ignored */
+#define KEY_EVENTS 128  /* every one of them can change in a cry */
+
+#define T_BIT_US    40
+#define T_RESET_US  96
+#define T0H_US      10
+#define T1H_US      25
+#define T_RESET_H_US 64
+
+#define AKELA_LOG 0
+
+#endif
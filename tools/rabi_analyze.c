@@ -0,0 +1,392 @@
+/**
+ * Decode a recorded CANINE trace offline, with the decoder of the Akela.
+ *
+ *   rabi_analyze [-f raw|vcd|csv] [-s signal] [-r samplerate] [-c] <file|->
+ *
+ * raw  the stream of rabi_capture -f raw
+ * vcd  a value change dump, -s picks the signal (default the first 1 bit one)
+ * csv  sigrok csv, -s picks the column, -r the samplerate if not in the file
+ *
+ * Reports the pulses per class with their margin to the decision points,
+ * the cries, and the frames and parity errors per rabi. -c prints every
+ * cry, handy to bisect where a trace goes wrong.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <getopt.h>
+#include "akela.h"
+#include "capture.h"
+
+/* Not used offline, akela_step() is never called */
+bool akela_data_ready(void) { return false; }
+int  akela_read(void) { return 0; }
+void akela_write(int bit) { }
+void akela_cry_start(uint64_t t_now_us) { }
+void akela_cry_done(uint64_t t_now_us, int n_rabies) { }
+
+enum {C_ZERO, C_ONE, C_RESET, C_N};
+static const char *class_names[C_N] = {"0", "1", "reset"};
+
+#define MARGIN_BIN_NS   500
+#define MARGIN_BINS     40
+
+struct pulse_class {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint32_t min_ns, max_ns;
+    int64_t min_margin_ns;
+    uint64_t margin_hist[MARGIN_BINS];
+} classes[C_N];
+
+static uint64_t unknown_pulses;
+static uint64_t cries, desyncs, resets;
+static uint64_t frames[W], toggles[W];
+static uint32_t events_tail;
+static uint32_t pack_min = -1, pack_max;
+static bool dump_cries;
+
+/* Feed one pulse, t_ns is when it went high as far as we know */
+static void pulse(uint32_t width_ns, uint64_t t_ns)
+{
+    int bit = timing_to_bit(width_ns);
+    int c = bit == RESET_MSG ? C_RESET : bit;
+    int64_t margin;
+
+    switch (c) {
+        case C_ZERO:
+            margin = (int64_t)T_ONE_NS - width_ns;
+            break;
+        case C_ONE:
+            margin = width_ns - (int64_t)T_ONE_NS;
+            if ((int64_t)T_RESET_NS - width_ns < margin)
+                margin = (int64_t)T_RESET_NS - width_ns;
+            break;
+        default:
+            margin = width_ns - (int64_t)T_RESET_NS;
+    }
+
+    struct pulse_class *pc = &classes[c];
+    if (!pc->count || width_ns < pc->min_ns) pc->min_ns = width_ns;
+    if (!pc->count || width_ns > pc->max_ns) pc->max_ns = width_ns;
+    if (!pc->count || margin < pc->min_margin_ns) pc->min_margin_ns = margin;
+    pc->count++;
+    pc->sum_ns += width_ns;
+    uint64_t bin = margin / MARGIN_BIN_NS;
+    pc->margin_hist[bin < MARGIN_BINS ? bin : MARGIN_BINS - 1]++;
+    if (!pulse_known(width_ns)) unknown_pulses++;
+
+    if (bit == RESET_MSG) {
+        resets++;
+        (void)statemachine(0, true, NULL);
+        return;
+    }
+
+    int n;
+    int r = statemachine(bit, false, &n);
+    if (r == -1) {
+        desyncs++;
+        if (dump_cries)
+            printf("%12.3f ms  desync\n", t_ns / 1e6);
+        return;
+    }
+    if (r != 1) return;
+
+    cries++;
+    if (n < pack_min) pack_min = n;
+    if (n > pack_max) pack_max = n;
+    flip(t_ns / 1000, n);
+    for (int i = 0; i < n && i < W; i++)
+        frames[i]++;
+    struct key_event e;
+    while (key_event_next(&events_tail, &e) == 1)
+        toggles[e.rabi] += e.rabi < n;
+    if (dump_cries) {
+        printf("%12.3f ms  cry %llu, %d rabies:", t_ns / 1e6, (unsigned long long)cries, n);
+        for (int i = 0; i < n && i < W; i++)
+            printf(" %x", key_states_read[i]);
+        putchar('\n');
+    }
+}
+
+/* The raw stream of the Akela */
+static void read_raw(FILE *f)
+{
+    static uint8_t buf[64 * 1024];
+    struct cap_decoder dec = {0};
+    uint64_t tick_hz = 62500000, t_ns = 0;
+    uint32_t last_t = 0;
+    uint64_t wraps = 0;
+    size_t n;
+    bool have_odd = false;
+    uint8_t odd = 0;
+
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        size_t i = 0;
+        while (i < n) {
+            uint16_t w;
+            if (have_odd) {
+                w = odd | buf[i++] << 8;
+                have_odd = false;
+            } else if (i + 1 < n) {
+                w = buf[i] | buf[i + 1] << 8;
+                i += 2;
+            } else {
+                odd = buf[i++];
+                have_odd = true;
+                break;
+            }
+
+            uint32_t v;
+            switch (cap_decode(&dec, w, &v)) {
+                case 0:
+                    break;
+                case CAP_PULSE:
+                    pulse(v * 1000000000ull / tick_hz, t_ns);
+                    break;
+                case CAP_TICK_HZ:
+                    tick_hz = v;
+                    break;
+                case CAP_CRY:
+                case CAP_RESET:
+                    if (v < last_t) wraps++;
+                    last_t = v;
+                    t_ns = ((wraps << 32) | v) * 1000;
+                    break;
+            }
+        }
+    }
+}
+
+/* Edges of one signal, as found in vcd and csv */
+static int level;
+static uint64_t t_rise;
+
+static void edge(int l, uint64_t t_ns)
+{
+    if (l == level) return;
+    level = l;
+    if (l)
+        t_rise = t_ns;
+    else
+        pulse(t_ns - t_rise, t_rise);
+}
+
+static char *next_token(FILE *f)
+{
+    static char tok[256];
+    int c, n = 0;
+
+    while ((c = getc_unlocked(f)) != EOF && isspace(c));
+    if (c == EOF) return NULL;
+    do {
+        if (n < (int)sizeof(tok) - 1) tok[n++] = c;
+    } while ((c = getc_unlocked(f)) != EOF && !isspace(c));
+    tok[n] = 0;
+    return tok;
+}
+
+static double unit_ns(const char *u)
+{
+    if (!strcmp(u, "s"))  return 1e9;
+    if (!strcmp(u, "ms")) return 1e6;
+    if (!strcmp(u, "us")) return 1e3;
+    if (!strcmp(u, "ns")) return 1;
+    if (!strcmp(u, "ps")) return 1e-3;
+    if (!strcmp(u, "fs")) return 1e-6;
+    fprintf(stderr, "unknown time unit %s\n", u);
+    exit(1);
+}
+
+static void read_vcd(FILE *f, const char *signal)
+{
+    char id[64] = "";
+    double ns_per_tick = 1;
+    uint64_t t = 0;
+    char *tok;
+
+    //Header, up to $enddefinitions
+    while ((tok = next_token(f)) && strcmp(tok, "$enddefinitions")) {
+        if (!strcmp(tok, "$timescale")) {
+            char num[64];
+            snprintf(num, sizeof(num), "%s", next_token(f));
+            char *u = num;
+            while (isdigit(*u)) u++;
+            //"1ns" or "1 ns"
+            const char *unit = *u ? u : next_token(f);
+            double mult = strtod(num, NULL);
+            ns_per_tick = mult * unit_ns(unit);
+        } else if (!strcmp(tok, "$var")) {
+            next_token(f);                          //type
+            int width = atoi(next_token(f));
+            char vid[64], name[64];
+            snprintf(vid, sizeof(vid), "%s", next_token(f));
+            snprintf(name, sizeof(name), "%s", next_token(f));
+            if (width == 1 && !*id && (!signal || !strcmp(signal, name)))
+                strcpy(id, vid);
+        }
+    }
+    if (!*id) {
+        fprintf(stderr, "signal %s not found\n", signal ? signal : "");
+        exit(1);
+    }
+
+    while ((tok = next_token(f))) {
+        switch (tok[0]) {
+            case '#':
+                t = strtoull(tok + 1, NULL, 10);
+                break;
+            case '0': case '1': case 'x': case 'X': case 'z': case 'Z':
+                if (!strcmp(tok + 1, id))
+                    edge(tok[0] == '1', t * ns_per_tick);
+                break;
+            case 'b': case 'B': {
+                int l = tok[strlen(tok) - 1] == '1';
+                if (!strcmp(next_token(f), id))
+                    edge(l, t * ns_per_tick);
+                break;
+            }
+        }
+    }
+}
+
+static void read_csv(FILE *f, const char *signal, double samplerate)
+{
+    static char line[4096];
+    int col = -1, time_col = -1;
+    uint64_t sample = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == ';') {
+            //; Samplerate: 1 MHz
+            char *s = strstr(line, "Samplerate:");
+            if (s && !samplerate) {
+                char unit[16] = "";
+                double v = 0;
+                sscanf(s + 11, "%lf %15s", &v, unit);
+                samplerate = v * (toupper(unit[0]) == 'G' ? 1e9 :
+                                  toupper(unit[0]) == 'M' ? 1e6 :
+                                  toupper(unit[0]) == 'K' ? 1e3 : 1);
+            }
+            continue;
+        }
+        if (col < 0) {
+            //The header with the channel names
+            int i = 0;
+            for (char *name = strtok(line, ",\r\n"); name; name = strtok(NULL, ",\r\n"), i++) {
+                while (isspace(*name)) name++;
+                if (!strncasecmp(name, "time", 4))
+                    time_col = i;
+                else if (col < 0 && (!signal || !strcmp(signal, name)))
+                    col = i;
+            }
+            if (col < 0) {
+                fprintf(stderr, "signal %s not found\n", signal ? signal : "");
+                exit(1);
+            }
+            if (time_col < 0 && !samplerate) {
+                fprintf(stderr, "no samplerate, use -r\n");
+                exit(1);
+            }
+            continue;
+        }
+
+        char *p = line;
+        double t_s = sample++ / samplerate;
+        int l = 0;
+        for (int i = 0; p; i++) {
+            if (i == time_col) t_s = strtod(p, NULL);
+            if (i == col) l = atoi(p);
+            p = strchr(p, ',');
+            if (p) p++;
+        }
+        edge(l != 0, t_s * 1e9);
+    }
+}
+
+static void report(void)
+{
+    uint64_t total = 0;
+    for (int c = 0; c < C_N; c++) total += classes[c].count;
+
+    printf("pulses %llu, unknown to a rabi %llu\n",
+            (unsigned long long)total, (unsigned long long)unknown_pulses);
+    printf("class      count   min us  mean us   max us  min margin us\n");
+    for (int c = 0; c < C_N; c++) {
+        struct pulse_class *pc = &classes[c];
+        if (!pc->count) continue;
+        printf("%-5s %10llu %8.2f %8.2f %8.2f %14.2f\n", class_names[c],
+                (unsigned long long)pc->count, pc->min_ns / 1e3,
+                pc->sum_ns / 1e3 / pc->count, pc->max_ns / 1e3,
+                pc->min_margin_ns / 1e3);
+    }
+    for (int c = 0; c < C_N; c++) {
+        struct pulse_class *pc = &classes[c];
+        if (!pc->count) continue;
+        printf("margin of class %s to the decision point:\n", class_names[c]);
+        for (int i = 0; i < MARGIN_BINS; i++) {
+            if (!pc->margin_hist[i]) continue;
+            printf("  %s%5.1f us %10llu\n", i == MARGIN_BINS - 1 ? ">=" : "  ",
+                    i * MARGIN_BIN_NS / 1e3, (unsigned long long)pc->margin_hist[i]);
+        }
+    }
+
+    printf("cries %llu, resets %llu, desyncs %llu",
+            (unsigned long long)cries, (unsigned long long)resets,
+            (unsigned long long)desyncs);
+    if (cries)
+        printf(", pack of %u..%u rabies", pack_min, pack_max);
+    printf("\nrabi     frames  bad frames   toggles\n");
+    for (int i = 0; i < W; i++) {
+        if (!frames[i] && !rabi_bad_frames[i]) continue;
+        printf("%4d %10llu  %10u %9llu\n", i, (unsigned long long)frames[i],
+                rabi_bad_frames[i], (unsigned long long)toggles[i]);
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-f raw|vcd|csv] [-s signal] [-r samplerate] [-c] <file|->\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *format = NULL, *signal = NULL;
+    double samplerate = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:s:r:c")) != -1) {
+        switch (opt) {
+            case 'f': format = optarg; break;
+            case 's': signal = optarg; break;
+            case 'r': samplerate = atof(optarg); break;
+            case 'c': dump_cries = true; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) usage(argv[0]);
+
+    const char *path = argv[optind];
+    FILE *f = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    if (!format) {
+        const char *ext = strrchr(path, '.');
+        format = ext && !strcmp(ext, ".vcd") ? "vcd" :
+                 ext && !strcmp(ext, ".csv") ? "csv" : "raw";
+    }
+
+    akela_init();
+    if (!strcmp(format, "raw")) read_raw(f);
+    else if (!strcmp(format, "vcd")) read_vcd(f, signal);
+    else if (!strcmp(format, "csv")) read_csv(f, signal, samplerate);
+    else usage(argv[0]);
+
+    report();
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * Record the raw pulse capture of the Akela.
+ *
+ *   rabi_capture [-f csv|vcd|raw] [-o file] [-b bit_us] [-r reset_us] <tty|->
+ *
+ * Opening the capture tty (the second ttyACM of the Akela) starts the
+ * capture, Ctrl-C stops it. '-' reads a recorded raw stream from stdin.
+ *
+ * The Akela only measures how long each pulse is high. The time between
+ * pulses is filled in assuming bits of bit_us and resets of reset_us, and is
+ * realigned on every cry or reset the Akela sends. So edges within a pulse
+ * are exact, the distance between pulses is nominal.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <termios.h>
+#include "capture.h"
+
+enum format {F_CSV, F_VCD, F_RAW};
+
+static enum format format = F_CSV;
+static FILE *out;
+static uint32_t bit_ns = 40 * 1000;
+static uint32_t reset_ns = 96 * 1000;
+static uint32_t tick_hz = 62500000;     //until the stream tells us
+
+static uint64_t cursor_ns;              //where the next pulse starts
+static int64_t base_ns;                 //Akela time of cursor_ns 0
+static bool have_base;
+static uint64_t pulses, markers, dropped;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{
+    stop = 1;
+}
+
+static void header(void)
+{
+    switch (format) {
+        case F_CSV:
+            fprintf(out, "t_ns,event,ticks,width_ns\n");
+            break;
+        case F_VCD:
+            fprintf(out,
+                    "$timescale 1ns $end\n"
+                    "$scope module akela $end\n"
+                    "$var wire 1 ! canine_in $end\n"
+                    "$var event 1 \" cry $end\n"
+                    "$var event 1 # reset $end\n"
+                    "$upscope $end\n"
+                    "$enddefinitions $end\n"
+                    "#0\n$dumpvars\n0!\n$end\n");
+            break;
+        case F_RAW:
+            break;
+    }
+}
+
+static void pulse(uint16_t ticks)
+{
+    uint64_t width_ns = (uint64_t)ticks * 1000000000 / tick_hz;
+
+    pulses++;
+    switch (format) {
+        case F_CSV:
+            fprintf(out, "%llu,%s,%u,%llu\n", (unsigned long long)cursor_ns,
+                    ticks == CAP_SATURATED ? "saturated" : "pulse",
+                    ticks, (unsigned long long)width_ns);
+            break;
+        case F_VCD:
+            fprintf(out, "#%llu\n1!\n#%llu\n0!\n", (unsigned long long)cursor_ns,
+                    (unsigned long long)(cursor_ns + width_ns));
+            break;
+        case F_RAW:
+            break;
+    }
+    uint64_t period = width_ns > bit_ns ? reset_ns : bit_ns;
+    if (period < width_ns + 1000)
+        period = width_ns + 1000;
+    cursor_ns += period;
+}
+
+static void marker(uint16_t m, uint32_t value)
+{
+    static uint32_t last_t;
+    static uint64_t wraps;
+
+    switch (m) {
+        case CAP_TICK_HZ:
+            tick_hz = value;
+            return;
+        case CAP_DROPPED:
+            dropped += value;
+            if (format == F_CSV)
+                fprintf(out, "%llu,dropped,%u,\n", (unsigned long long)cursor_ns, value);
+            return;
+    }
+
+    //Realign our idea of time on the timestamp of the Akela
+    markers++;
+    if (value < last_t) wraps++;
+    last_t = value;
+    int64_t t_ns = (int64_t)((wraps << 32) | value) * 1000;
+    if (!have_base) {
+        base_ns = t_ns - cursor_ns;
+        have_base = true;
+    }
+    if (t_ns - base_ns > (int64_t)cursor_ns)
+        cursor_ns = t_ns - base_ns;
+
+    const char *name = m == CAP_CRY ? "cry" : "reset";
+    switch (format) {
+        case F_CSV:
+            fprintf(out, "%llu,%s,,\n", (unsigned long long)cursor_ns, name);
+            break;
+        case F_VCD:
+            fprintf(out, "#%llu\n1%c\n", (unsigned long long)cursor_ns, m == CAP_CRY ? '"' : '#');
+            break;
+        case F_RAW:
+            break;
+    }
+}
+
+/* Feed one word of the stream */
+static void word(uint16_t w)
+{
+    static struct cap_decoder dec;
+    uint32_t value;
+
+    int r = cap_decode(&dec, w, &value);
+    if (r == CAP_PULSE)
+        pulse(value);
+    else if (r)
+        marker(r, value);
+}
+
+static int open_input(const char *path)
+{
+    if (!strcmp(path, "-"))
+        return STDIN_FILENO;
+
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-f csv|vcd|raw] [-o file] [-b bit_us] [-r reset_us] <tty|->\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:o:b:r:")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (!strcmp(optarg, "csv")) format = F_CSV;
+                else if (!strcmp(optarg, "vcd")) format = F_VCD;
+                else if (!strcmp(optarg, "raw")) format = F_RAW;
+                else usage(argv[0]);
+                break;
+            case 'o': out_path = optarg; break;
+            case 'b': bit_ns = atoi(optarg) * 1000; break;
+            case 'r': reset_ns = atoi(optarg) * 1000; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) usage(argv[0]);
+
+    out = stdout;
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror(out_path);
+        return 1;
+    }
+    int fd = open_input(argv[optind]);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    header();
+
+    static uint8_t buf[64 * 1024];
+    uint8_t odd = 0;
+    bool have_odd = false;
+    while (!stop) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        if (format == F_RAW)
+            fwrite(buf, 1, n, out);
+
+        ssize_t i = 0;
+        if (have_odd) {
+            word(odd | buf[i++] << 8);
+            have_odd = false;
+        }
+        for (; i + 1 < n; i += 2)
+            word(buf[i] | buf[i + 1] << 8);
+        if (i < n) {
+            odd = buf[i];
+            have_odd = true;
+        }
+    }
+
+    fclose(out);
+    fprintf(stderr, "%llu pulses, %llu markers, %llu dropped\n",
+            (unsigned long long)pulses, (unsigned long long)markers,
+            (unsigned long long)dropped);
+    return 0;
+}
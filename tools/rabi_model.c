@@ -0,0 +1,124 @@
+/**
+ * How fast is a pack, from the model in librabi/canine_model.h.
+ *
+ *   rabi_model [-W rabies] [-K bits] [-D changed] [-b bit_us] [-0 t0h_us]
+ *              [-1 t1h_us] [-d hop_us] [-p akela_us] [-l led_us] [-r report_us]
+ *              [-u poll_us]
+ *   rabi_model -t first..last[/step] [...]     one line per pack size
+ *
+ * The defaults are the raddr and Akela firmware as they are. The hop is
+ * from the falling edge in until a rabi starts sending, the Akela time is
+ * between the howl and the next growl. Every 20ms the Akela updates the leds,
+ * which blocks for led_us. The HID report goes out every report_us, the host
+ * polls every poll_us. With -D the pack does delta polls, with that many
+ * rabies sending a frame in every cry.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "canine_model.h"
+
+#define LED_PERIOD_US 20000
+
+static double t0h_us = 10;
+static double led_us = (25 - 8) * 30;  //25 leds, 8 fit the PIO fifo, 30us each
+static double report_us = 10000;
+static double poll_us = 5000;
+
+/* Averaged over the led updates */
+static double scan_hz(const struct canine_model *m)
+{
+    double cry = canine_cry_us(m);
+    return 1e6 / (cry + led_us * cry / LED_PERIOD_US);
+}
+
+/* Worst case from a key edge until the Akela knows. A led update fits in */
+static double akela_latency_us(const struct canine_model *m)
+{
+    return canine_latency_us(m) + led_us;
+}
+
+/* The report was just gone, the next one goes after the first cry done after
+ * report_us. Then the host has to come and get it */
+static double host_latency_us(const struct canine_model *m)
+{
+    return akela_latency_us(m) + report_us + canine_cry_us(m) + poll_us;
+}
+
+static void show(const struct canine_model *m)
+{
+    printf("W=%u K=%u, %.0fus bits (1 high %.0fus), hop %.0fus, Akela %.0fus\n",
+            m->w, m->k, m->t_bit_us, m->t1h_us, m->hop_us, m->akela_us);
+    if (m->delta)
+        printf("  delta polls, %u of them changed\n", m->changed);
+    printf("  bits per cry      %8u\n", canine_cry_bits(m));
+    printf("  cry period        %8.0f us\n", canine_cry_us(m));
+    printf("  with led update   %8.0f us\n", canine_cry_us(m) + led_us);
+    printf("  scan rate         %8.1f Hz\n", scan_hz(m));
+    printf("  last rabi sampled %8.0f us into the cry\n", canine_sample_us(m, m->w - 1));
+    printf("  key to Akela      %8.0f us worst case\n", akela_latency_us(m));
+    printf("  key to host       %8.0f us worst case\n", host_latency_us(m));
+}
+
+static void table(struct canine_model *m, unsigned first, unsigned last, unsigned step)
+{
+    printf("%5s %6s %10s %10s %12s %12s\n",
+            "W", "bits", "cry_us", "scan_hz", "akela_us", "host_us");
+    for (m->w = first; m->w <= last; m->w += step)
+        printf("%5u %6u %10.0f %10.1f %12.0f %12.0f\n", m->w, canine_cry_bits(m),
+                canine_cry_us(m), scan_hz(m), akela_latency_us(m), host_latency_us(m));
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-W rabies] [-K bits] [-D changed] [-b bit_us] [-0 t0h_us]\n"
+                    "       [-1 t1h_us] [-d hop_us] [-p akela_us] [-l led_us] [-r report_us]\n"
+                    "       [-u poll_us]\n"
+                    "       [-t first..last[/step]]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    struct canine_model m = {
+        .w = 25, .k = 1, .t_bit_us = 40, .t1h_us = 25, .hop_us = 3, .akela_us = 10,
+    };
+    unsigned first = 0, last = 0, step = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "W:K:D:b:0:1:d:p:l:r:u:t:")) != -1) {
+        switch (opt) {
+            case 'W': m.w = atoi(optarg); break;
+            case 'K': m.k = atoi(optarg); break;
+            case 'D': m.delta = 1; m.changed = atoi(optarg); break;
+            case 'b': m.t_bit_us = atof(optarg); break;
+            case '0': t0h_us = atof(optarg); break;
+            case '1': m.t1h_us = atof(optarg); break;
+            case 'd': m.hop_us = atof(optarg); break;
+            case 'p': m.akela_us = atof(optarg); break;
+            case 'l': led_us = atof(optarg); break;
+            case 'r': report_us = atof(optarg); break;
+            case 'u': poll_us = atof(optarg); break;
+            case 't':
+                if (sscanf(optarg, "%u..%u/%u", &first, &last, &step) < 2 || !first || !step)
+                    usage(argv[0]);
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || !m.w || !m.k) usage(argv[0]);
+
+    //A 0 is sent as soon as it arrives, but then waits for the output. The
+    //model only holds as long as it is shorter than a 1
+    if (!(t0h_us < m.t1h_us && m.t1h_us < m.t_bit_us)) {
+        fprintf(stderr, "need T0H < T1H < TTOTAL\n");
+        return 1;
+    }
+
+    if (first)
+        table(&m, first, last, step);
+    else
+        show(&m);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * Decode the telemetry records of the Akela.
+ *
+ *   rabi_telemetry /dev/ttyACM0     enable telemetry and decode
+ *   rabi_telemetry - < dump.bin     decode a capture
+ *
+ * Console text between the records is passed through. Counters and
+ * histograms are printed as the difference with the previous record.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "telemetry.h"
+
+static const char *counter_names[TM_N_COUNTERS] = TM_COUNTER_NAMES;
+
+static uint32_t last_counters[TM_N_COUNTERS];
+static uint32_t last_t_ms;
+static uint32_t last_cry[TM_CRY_BINS];
+static uint32_t last_pulse[TM_PULSE_BINS];
+static uint32_t last_latency[TM_LATENCY_BINS];
+static unsigned bad_records, lost_records;
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static void print_counters(const uint8_t *p, unsigned len)
+{
+    if (len != 4 + 4 * TM_N_COUNTERS) {
+        printf("# counters: unexpected length %u\n", len);
+        return;
+    }
+    uint32_t t_ms = get_u32(p);
+    printf("# %u.%03u s (+%u ms)\n", t_ms / 1000, t_ms % 1000, t_ms - last_t_ms);
+    last_t_ms = t_ms;
+    for (int i = 0; i < TM_N_COUNTERS; i++) {
+        uint32_t v = get_u32(p + 4 + 4 * i);
+        if (i == TM_RECOVERY_MAX_US || i == TM_LATENCY_MAX_US)
+            printf("#   %-16s %10u\n", counter_names[i], v);
+        else
+            printf("#   %-16s %10u  +%u\n", counter_names[i], v, v - last_counters[i]);
+        last_counters[i] = v;
+    }
+}
+
+static void print_hist(const char *name, const char *unit, const uint8_t *p,
+        unsigned len, uint32_t *last, unsigned max_bins)
+{
+    unsigned width = get_u16(p);
+    unsigned bins = get_u16(p + 2);
+    if (len != 4 + 4 * bins || bins > max_bins) {
+        printf("# %s: unexpected length %u\n", name, len);
+        return;
+    }
+
+    uint32_t delta[bins], max = 0;
+    for (unsigned i = 0; i < bins; i++) {
+        uint32_t v = get_u32(p + 4 + 4 * i);
+        delta[i] = v - last[i];
+        last[i] = v;
+        if (delta[i] > max) max = delta[i];
+    }
+    printf("# %s (%u %s per bin)\n", name, width, unit);
+    for (unsigned i = 0; i < bins; i++) {
+        if (!delta[i]) continue;
+        printf("#   %s%5u %10u ", i == bins - 1 ? ">=" : "  ", i * width, delta[i]);
+        for (unsigned j = 0; j < delta[i] * 40 / max; j++) putchar('*');
+        putchar('\n');
+    }
+}
+
+static void record(const uint8_t *r, unsigned len)
+{
+    static int last_seq = -1;
+    uint8_t type = r[2];
+    uint8_t seq = r[3];
+
+    if (last_seq >= 0 && seq != (uint8_t)(last_seq + 1))
+        lost_records += (uint8_t)(seq - last_seq - 1);
+    last_seq = seq;
+
+    const uint8_t *p = r + TM_HEADER_LEN;
+    switch (type) {
+        case TM_REC_COUNTERS:
+            print_counters(p, len);
+            break;
+        case TM_REC_CRY_HIST:
+            print_hist("cry duration", "us", p, len, last_cry, TM_CRY_BINS);
+            break;
+        case TM_REC_PULSE_HIST:
+            print_hist("pulse width", "ns", p, len, last_pulse, TM_PULSE_BINS);
+            break;
+        case TM_REC_LATENCY_HIST:
+            print_hist("latency to the host", "us", p, len, last_latency, TM_LATENCY_BINS);
+            if (bad_records || lost_records)
+                printf("# bad records %u, lost records %u\n", bad_records, lost_records);
+            break;
+        default:
+            printf("# unknown record %u\n", type);
+    }
+    fflush(stdout);
+}
+
+static int open_input(const char *path)
+{
+    if (!strcmp(path, "-"))
+        return STDIN_FILENO;
+
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        //Start the records
+        if (write(fd, "T", 1) != 1)
+            perror("enable telemetry");
+    }
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t buf[TM_HEADER_LEN + TM_MAX_PAYLOAD + 2];
+    unsigned n = 0;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <tty|->\n", argv[0]);
+        return 1;
+    }
+    int fd = open_input(argv[1]);
+
+    while (1) {
+        uint8_t c;
+        ssize_t r = read(fd, &c, 1);
+        if (r <= 0) break;
+        buf[n++] = c;
+
+        //Hunt for the sync word, pass everything else through
+        if (n == 1 && c != (TM_SYNC & 0xFF)) {
+            putchar(c);
+            if (c == '\n') fflush(stdout);
+            n = 0;
+            continue;
+        }
+        if (n == 2 && c != TM_SYNC >> 8) {
+            putchar(buf[0]);
+            buf[0] = c;
+            n = c == (TM_SYNC & 0xFF);
+            if (!n) putchar(c);
+            continue;
+        }
+        if (n < TM_HEADER_LEN) continue;
+
+        unsigned len = get_u16(&buf[4]);
+        if (len > TM_MAX_PAYLOAD) {
+            bad_records++;
+            n = 0;
+            continue;
+        }
+        if (n < TM_HEADER_LEN + len + 2) continue;
+
+        uint16_t sum = get_u16(&buf[TM_HEADER_LEN + len]);
+        if (sum == tm_fletcher16(&buf[2], TM_HEADER_LEN - 2 + len))
+            record(buf, len);
+        else
+            bad_records++;
+        n = 0;
+    }
+    return 0;
+}
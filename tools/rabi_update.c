@@ -0,0 +1,97 @@
+/**
+ * Firmware update of a whole pack, through the console of the Akela.
+ *
+ *   rabi_update /dev/ttyACM0 Build/app.bin
+ *
+ * Sends the image, then prints the progress the Akela reports until it is
+ * done. Exits 0 when every rabi runs the image. The image is the
+ * application linked behind the bootloader, see rabi-py32f0/raddr/boot.h.
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "bulk.h"
+
+#define MAX_IMAGE (255 * BULK_PAGE_SIZE)
+
+static uint8_t image[MAX_IMAGE];
+
+static void write_all(int fd, const void *p, size_t n)
+{
+    while (n) {
+        ssize_t r = write(fd, p, n);
+        if (r <= 0) {
+            perror("write");
+            exit(1);
+        }
+        p = (const uint8_t *)p + r;
+        n -= r;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <tty> <image.bin>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[2], "rb");
+    if (!f) {
+        perror(argv[2]);
+        return 1;
+    }
+    size_t size = fread(image, 1, sizeof(image), f);
+    if (!feof(f) || !size) {
+        fprintf(stderr, "%s: empty or larger than %u bytes\n", argv[2], MAX_IMAGE);
+        return 1;
+    }
+    fclose(f);
+
+    int fd = open(argv[1], O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIFLUSH);
+
+    uint8_t hdr[5] = {'U', size, size >> 8, size >> 16, size >> 24};
+    write_all(fd, hdr, sizeof(hdr));
+    write_all(fd, image, size);
+    printf("sent %zu bytes, crc16 %04x\n", size, crc16(CRC16_INIT, image, size));
+
+    //Only our lines, the Akela has more to say
+    char line[256];
+    unsigned n = 0;
+    while (1) {
+        char c;
+        if (read(fd, &c, 1) != 1)
+            break;
+        if (c != '\n') {
+            if (n < sizeof(line) - 1)
+                line[n++] = c;
+            continue;
+        }
+        line[n] = 0;
+        n = 0;
+        if (strncmp(line, "update:", 7))
+            continue;
+        printf("%s\n", line);
+        fflush(stdout);
+        if (!strncmp(line, "update: done", 12))
+            return 0;
+        if (!strncmp(line, "update: failed", 14) || !strncmp(line, "update: bad", 11) ||
+                !strncmp(line, "update: timeout", 15))
+            return 1;
+    }
+    fprintf(stderr, "%s: lost the Akela\n", argv[1]);
+    return 1;
+}